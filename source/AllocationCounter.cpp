@@ -0,0 +1,82 @@
+//-----------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------
+#include "pch.h"
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace dae;
+
+
+namespace
+{
+	std::atomic<uint64_t> g_NumAllocations{};
+}
+
+
+//-----------------------------------------------------------------
+// Public Functions
+//-----------------------------------------------------------------
+uint64_t AllocationCounter::GetCount()
+{
+	return g_NumAllocations.load(std::memory_order_relaxed);
+}
+
+
+//-----------------------------------------------------------------
+// Global Allocation Functions
+//-----------------------------------------------------------------
+//The array and nothrow forms forward to these, plain and aligned (tiled textures)
+void* operator new(size_t size)
+{
+	g_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (size == 0) size = 1;
+	if (void* pMemory = std::malloc(size))
+		return pMemory;
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	g_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	//aligned_alloc takes whole multiples of the alignment only, MSVC has its own aligned pair instead
+	const size_t align{ static_cast<size_t>(alignment) };
+	if (size == 0) size = 1;
+#if defined(_MSC_VER)
+	if (void* pMemory = _aligned_malloc(size, align))
+#else
+	if (void* pMemory = std::aligned_alloc(align, (size + align - 1) & ~(align - 1)))
+#endif
+		return pMemory;
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pMemory, std::align_val_t) noexcept
+{
+#if defined(_MSC_VER)
+	_aligned_free(pMemory);
+#else
+	std::free(pMemory);
+#endif
+}
+
+void operator delete(void* pMemory, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(pMemory, alignment);
+}
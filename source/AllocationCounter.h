@@ -0,0 +1,12 @@
+#pragma once
+// Includes
+
+namespace dae
+{
+	//Counts every global operator new of the process, so frames can check they stay off the heap
+	//The count is a relaxed atomic increment, cheap enough to keep in release builds
+	namespace AllocationCounter
+	{
+		uint64_t GetCount();
+	}
+}
@@ -39,6 +39,10 @@ Camera::~Camera()
 //-----------------------------------------------------------------
 void Camera::Update(const Timer* pTimer)
 {
+#if defined(HEADLESS)
+	//No input devices in headless builds, the camera stays where it was placed
+	(void)pTimer;
+#else
 	const float deltaTime = pTimer->GetElapsed();
 
 	//Keyboard Input
@@ -80,6 +84,7 @@ void Camera::Update(const Timer* pTimer)
 		//Update Matrices
 		CalculateViewMatrix();
 	}
+#endif
 }
 
 void Camera::SetFovAngle(float fovAngle)
@@ -2,6 +2,9 @@
 
 namespace dae
 {
+	// Class Forward Declarations
+	class HiZBuffer;
+
 	struct Vertex
 	{
 		Vector3 position{};
@@ -18,4 +21,242 @@ namespace dae
 		Vector2 uv{};
 		Vector3 worldPosition{};
 	};
+
+	//Post-transform vertices as structure of arrays, every stream is indexed like the input vertices
+	//Position is in clip space, the mesh clips and divides by w itself
+	struct VertexStreams
+	{
+		static constexpr int numStreams{ 15 };
+
+		float* pPositionX{};
+		float* pPositionY{};
+		float* pPositionZ{};
+		float* pPositionW{};
+		float* pUvX{};
+		float* pUvY{};
+		float* pNormalX{};
+		float* pNormalY{};
+		float* pNormalZ{};
+		float* pTangentX{};
+		float* pTangentY{};
+		float* pTangentZ{};
+		float* pWorldX{};
+		float* pWorldY{};
+		float* pWorldZ{};
+
+		//Splits numStreams * count floats up into the streams
+		void Assign(float* pMemory, size_t count)
+		{
+			float** pStreams[numStreams]
+			{
+				&pPositionX, &pPositionY, &pPositionZ, &pPositionW, &pUvX, &pUvY,
+				&pNormalX, &pNormalY, &pNormalZ, &pTangentX, &pTangentY, &pTangentZ,
+				&pWorldX, &pWorldY, &pWorldZ
+			};
+
+			for (int i{}; i < numStreams; ++i)
+			{
+				*pStreams[i] = pMemory + i * count;
+			}
+		}
+
+		//One vertex as a whole, for clipping
+		//Normal, tangent and world position stay zero unless the material wrote their streams (Material::HasSurfaceAttributes)
+		Vertex_Out Gather(uint32_t index, bool hasSurfaceAttributes) const
+		{
+			Vertex_Out v{};
+			v.position = { pPositionX[index], pPositionY[index], pPositionZ[index], pPositionW[index] };
+			v.uv = { pUvX[index], pUvY[index] };
+			if (hasSurfaceAttributes)
+			{
+				v.normal = { pNormalX[index], pNormalY[index], pNormalZ[index] };
+				v.tangent = { pTangentX[index], pTangentY[index], pTangentZ[index] };
+				v.worldPosition = { pWorldX[index], pWorldY[index], pWorldZ[index] };
+			}
+			return v;
+		}
+	};
+
+	//A value that is linear in raster space: value = origin + x * dx + y * dy
+	//origin is the value at the sample point of pixel (0, 0), so a pixel is evaluated with its integer coordinates
+	struct AttributePlane
+	{
+		float origin{};
+		float dx{};
+		float dy{};
+
+		//Plane through the values at the vertices, weight1/weight2 are the planes of the barycentric weights of vertex 1 and 2
+		void Set(float a0, float a1, float a2, const AttributePlane& weight1, const AttributePlane& weight2)
+		{
+			const float d1{ a1 - a0 };
+			const float d2{ a2 - a0 };
+
+			origin = a0 + d1 * weight1.origin + d2 * weight2.origin;
+			dx = d1 * weight1.dx + d2 * weight2.dx;
+			dy = d1 * weight1.dy + d2 * weight2.dy;
+		}
+
+		float Evaluate(float x, float y) const
+		{
+			return origin + x * dx + y * dy;
+		}
+	};
+
+	//Which triangles get discarded, shared by the hardware and software rasterizer
+	//Front faces are clockwise on screen
+	enum class CullMode
+	{
+		Back,
+		Front,
+		None,
+
+		//@END
+		END
+	};
+
+	//Texture filter of the sampler states in the effects, mirrored by the software texture sampling
+	enum class SamplerFilter
+	{
+		Point,
+		Linear,
+		Anisotropic,
+
+		//@END
+		END
+	};
+
+	//Texture address mode of the sampler states in the effects (AddressU/V), mirrored by the software texture sampling
+	//Border reads transparent black
+	enum class AddressMode
+	{
+		Wrap,
+		Clamp,
+		Mirror,
+		Border,
+
+		//@END
+		END
+	};
+
+	//Raster space triangle, ready to be rasterized by any tile it overlaps
+	//Only holds what the rasterizer reads: edges, bounding box and the attribute planes, no vertices
+	struct TriangleSetup
+	{
+		//Raster space positions (snapped to the 24.8 grid for the fixed-point rasterizer), edges and attribute planes start from these
+		Vector2 position0{};
+		Vector2 position1{};
+		Vector2 position2{};
+
+		//Fixed-point edge functions from 24.8 snapped vertices, top-left bias included: E = origin + px * stepX + py * stepY
+		int64_t edgeOrigin[3]{};
+		int64_t edgeStepX[3]{};
+		int64_t edgeStepY[3]{};
+
+		//Pixels covered by the bounding box: [min, max)
+		Int2 min{};
+		Int2 max{};
+
+		//Nearest depth of the triangle, for the Hi-Z test
+		float minDepth{};
+
+		//Index in the frame's triangle table, stored in the visibility buffer (deferred shading only)
+		uint32_t id{};
+
+		//Interpolants as raster space planes, evaluated per pixel without any barycentrics
+		//depth is z / w, the perspective correct ones are divided by w (value = plane / invW), worldPosition is linear on screen
+		AttributePlane depth{};
+		AttributePlane invW{};
+		AttributePlane uvX{};
+		AttributePlane uvY{};
+		AttributePlane normalX{};
+		AttributePlane normalY{};
+		AttributePlane normalZ{};
+		AttributePlane tangentX{};
+		AttributePlane tangentY{};
+		AttributePlane tangentZ{};
+		AttributePlane worldX{};
+		AttributePlane worldY{};
+		AttributePlane worldZ{};
+	};
+
+	//Counters of the last software frame
+	struct PipelineStats
+	{
+		uint32_t numVertices{};			//Vertices in the mesh
+		uint32_t numShadedVertices{};	//Vertices whose attributes got shaded (lazy: only those of triangles that were set up)
+		uint32_t numTriangles{};		//Triangles in the mesh
+		uint32_t numCulled{};			//Culled in object space, before vertex shading
+		uint32_t numSetUp{};			//Set up for rasterization (after frustum culling and clipping)
+		uint32_t numBinned{};			//Triangle/tile pairs to rasterize
+		uint32_t numHiZTriangles{};		//Triangle/tile pairs rejected by the Hi-Z
+		uint32_t numHiZBlocks{};		//Pixel blocks rejected by the Hi-Z
+	};
+
+	//Pixel shader inputs of a batch of 2x2 pixel quads, one lane per pixel (structure of arrays, so shaders can work on all lanes at once)
+	//Lane = quad * 4 + dy * 2 + dx. Quads are always complete: lanes outside the pixel mask are helpers, they only feed the derivatives
+	//Normal and tangent are perspective corrected but not normalized yet
+	struct PixelLanes
+	{
+		static constexpr int size{ 8 };
+		static constexpr int quadSize{ 4 };
+		static constexpr int numQuads{ size / quadSize };
+
+		alignas(32) float uvX[size]{};
+		alignas(32) float uvY[size]{};
+		alignas(32) float normalX[size]{};
+		alignas(32) float normalY[size]{};
+		alignas(32) float normalZ[size]{};
+		alignas(32) float tangentX[size]{};
+		alignas(32) float tangentY[size]{};
+		alignas(32) float tangentZ[size]{};
+		alignas(32) float worldX[size]{};
+		alignas(32) float worldY[size]{};
+		alignas(32) float worldZ[size]{};
+
+		//Screen space derivatives of a value per lane (one of the arrays above or computed from them)
+		//Coarse, like ddx/ddy in HLSL: one difference per quad, taken from its top-left pixel
+		static float Ddx(const float* pValues, int lane)
+		{
+			const int quad{ lane & ~(quadSize - 1) };
+			return pValues[quad + 1] - pValues[quad];
+		}
+
+		static float Ddy(const float* pValues, int lane)
+		{
+			const int quad{ lane & ~(quadSize - 1) };
+			return pValues[quad + 2] - pValues[quad];
+		}
+	};
+
+	//Targets of the software rasterizer, owned by the renderer and shared by every mesh drawn into them
+	//The color target either wraps the pixels of an SDL_Surface or an offscreen buffer (headless)
+	struct FrameBuffer
+	{
+		static constexpr uint32_t noTriangle{ UINT32_MAX };
+
+		uint32_t* pPixels{};
+		int width{};
+		int height{};
+
+		//Depth + its Hi-Z pyramid, cleared once per frame so meshes depth test against each other
+		float* pDepthPixels{};
+		HiZBuffer* pHiZBuffer{};
+
+		//Visibility buffer for deferred shading: noTriangle, except between a deferred draw and its shading pass
+		uint32_t* pTriangleIds{};
+
+		//Weighted blended transparency: weighted premultiplied color + alpha (4 floats per pixel) and the product of (1 - alpha)
+		//Zero and one, except between the weighted blended draws of a frame and their resolve
+		float* pAccumulation{};
+		float* pRevealage{};
+
+		uint8_t redShift{ 16 };
+		uint8_t greenShift{ 8 };
+		uint8_t blueShift{ 0 };
+
+		uint32_t MapRGB(uint8_t r, uint8_t g, uint8_t b) const
+		{
+			return (uint32_t(r) << redShift) | (uint32_t(g) << greenShift) | (uint32_t(b) << blueShift);
+		}
+	};
 }
@@ -0,0 +1,84 @@
+//-----------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------
+#include "pch.h"
+#include "FrameArena.h"
+
+using namespace dae;
+
+
+//-----------------------------------------------------------------
+// Constructors
+//-----------------------------------------------------------------
+FrameArena::FrameArena(size_t capacity)
+	: m_Capacity{ capacity }
+{
+	m_pBlock = new std::byte[capacity];
+}
+
+
+//-----------------------------------------------------------------
+// Destructor
+//-----------------------------------------------------------------
+FrameArena::~FrameArena()
+{
+	for (std::byte* pBlock : m_OverflowBlocks)
+	{
+		delete[] pBlock;
+	}
+
+	delete[] m_pBlock;
+}
+
+
+//-----------------------------------------------------------------
+// Public Member Functions
+//-----------------------------------------------------------------
+bool FrameArena::Reset()
+{
+	//1. Everything the last frame asked for, including what did not fit
+	const size_t usedSize{ m_Offset.exchange(0) };
+
+	for (std::byte* pBlock : m_OverflowBlocks)
+	{
+		delete[] pBlock;
+	}
+	m_OverflowBlocks.clear();
+
+	if (usedSize <= m_Capacity)
+		return false;
+
+	//2. Grow with some headroom, frames differ a little in size
+	delete[] m_pBlock;
+	m_Capacity = usedSize + usedSize / 2;
+	m_pBlock = new std::byte[m_Capacity];
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------
+// Private Member Functions
+//-----------------------------------------------------------------
+void* FrameArena::AllocateBytes(size_t size, size_t alignment)
+{
+	//1. Claim the size + worst case padding, the start is aligned inside that range
+	const size_t claimSize{ size + alignment - 1 };
+	const size_t offset{ m_Offset.fetch_add(claimSize, std::memory_order_relaxed) };
+
+	if (offset + claimSize <= m_Capacity)
+	{
+		const uintptr_t address{ reinterpret_cast<uintptr_t>(m_pBlock + offset) };
+		return reinterpret_cast<void*>((address + alignment - 1) & ~(uintptr_t(alignment) - 1));
+	}
+
+	//2. Out of space: serve it from the heap this frame, Reset grows the block for the next one
+	std::byte* pBlock{ new std::byte[claimSize] };
+	{
+		std::lock_guard<std::mutex> lock{ m_OverflowMutex };
+		m_OverflowBlocks.push_back(pBlock);
+	}
+
+	const uintptr_t address{ reinterpret_cast<uintptr_t>(pBlock) };
+	return reinterpret_cast<void*>((address + alignment - 1) & ~(uintptr_t(alignment) - 1));
+}
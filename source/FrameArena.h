@@ -0,0 +1,118 @@
+#pragma once
+// Includes
+#include <atomic>
+#include <mutex>
+#include <cstring>
+#include <type_traits>
+
+namespace dae
+{
+	// Class Declaration
+	//Linear allocator for everything the software pipeline only needs during one frame
+	//Allocating is a single atomic add, so any thread may allocate; nothing is freed until Reset
+	class FrameArena final
+	{
+	public:
+		// Constructors and Destructor
+		explicit FrameArena(size_t capacity);
+		~FrameArena();
+
+		// Copy and Move semantics
+		FrameArena(const FrameArena& other)					= delete;
+		FrameArena& operator=(const FrameArena& other)		= delete;
+		FrameArena(FrameArena&& other) noexcept				= delete;
+		FrameArena& operator=(FrameArena&& other) noexcept	= delete;
+
+		//---------------------------
+		// Public Member Functions
+		//---------------------------
+		//Start of a frame: every allocation of the previous frame becomes invalid
+		//A frame that did not fit grows the arena to its size here, so the next frames fit again
+		//Returns true when the arena had to grow (which is the only time it touches the heap)
+		bool Reset();
+
+		//Uninitialized storage for count objects
+		template<typename T>
+		T* Allocate(size_t count)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "The arena never runs destructors");
+			return static_cast<T*>(AllocateBytes(count * sizeof(T), alignof(T)));
+		}
+
+		//This frame asked for more than the block holds, part of it came from the heap
+		bool HasOverflowed() const { return m_Offset.load(std::memory_order_relaxed) > m_Capacity; }
+		size_t GetCapacity() const { return m_Capacity; }
+
+
+	private:
+		// Member variables
+		std::byte* m_pBlock{};
+		size_t m_Capacity{};
+		std::atomic<size_t> m_Offset{};
+
+		//Allocations past the end of the block, only until the next Reset
+		std::mutex m_OverflowMutex{};
+		std::vector<std::byte*> m_OverflowBlocks{};
+
+		//---------------------------
+		// Private Member Functions
+		//---------------------------
+		void* AllocateBytes(size_t size, size_t alignment);
+
+	};
+
+	// Class Declaration
+	//Growable array in a FrameArena: growing copies into a new piece, the old one is given back at Reset
+	template<typename T>
+	class FrameVector final
+	{
+	public:
+		static_assert(std::is_trivially_copyable_v<T>, "Growing copies the elements bytewise");
+
+		// Constructors and Destructor
+		FrameVector() = default;
+		explicit FrameVector(FrameArena* pArena, uint32_t capacity)
+			: m_pArena{ pArena }
+			, m_pData{ capacity > 0 ? pArena->Allocate<T>(capacity) : nullptr }
+			, m_Capacity{ capacity }
+		{
+		}
+
+		//---------------------------
+		// Public Member Functions
+		//---------------------------
+		void push_back(const T& value)
+		{
+			if (m_Size == m_Capacity)
+			{
+				const uint32_t capacity{ std::max(m_Capacity * 2, m_MinCapacity) };
+				T* pData{ m_pArena->Allocate<T>(capacity) };
+				if (m_Size > 0) std::memcpy(pData, m_pData, m_Size * sizeof(T));
+
+				m_pData = pData;
+				m_Capacity = capacity;
+			}
+
+			m_pData[m_Size++] = value;
+		}
+
+		T& operator[](uint32_t index) { return m_pData[index]; }
+		const T& operator[](uint32_t index) const { return m_pData[index]; }
+
+		uint32_t size() const { return m_Size; }
+		T* begin() { return m_pData; }
+		T* end() { return m_pData + m_Size; }
+		const T* begin() const { return m_pData; }
+		const T* end() const { return m_pData + m_Size; }
+
+
+	private:
+		// Member variables
+		FrameArena* m_pArena{};
+		T* m_pData{};
+		uint32_t m_Size{};
+		uint32_t m_Capacity{};
+
+		static constexpr uint32_t m_MinCapacity{ 16 };
+	};
+}
@@ -0,0 +1,136 @@
+//-----------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------
+#include "pch.h"
+#include "HeadlessRenderer.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+#include "HiZBuffer.h"
+#include "FrameArena.h"
+#include "AllocationCounter.h"
+#include <cassert>
+#include <fstream>
+
+using namespace dae;
+
+
+//-----------------------------------------------------------------
+// Constructors
+//-----------------------------------------------------------------
+HeadlessRenderer::HeadlessRenderer(int width, int height, uint32_t numThreads)
+{
+	//Create offscreen ColorBuffer (same channel order as the SDL BackBuffer)
+	m_pColorBufferPixels = new uint32_t[width * height];
+
+	m_FrameBuffer.pPixels = m_pColorBufferPixels;
+	m_FrameBuffer.width = width;
+	m_FrameBuffer.height = height;
+
+	//Create DepthBuffer + Visibility Buffer, shared by every mesh
+	m_pDepthBufferPixels = new float[width * height];
+	m_pHiZBuffer = new HiZBuffer(width, height);
+	m_pTriangleIds = new uint32_t[width * height];
+	std::fill_n(m_pTriangleIds, width * height, FrameBuffer::noTriangle);
+
+	m_FrameBuffer.pDepthPixels = m_pDepthBufferPixels;
+	m_FrameBuffer.pHiZBuffer = m_pHiZBuffer;
+	m_FrameBuffer.pTriangleIds = m_pTriangleIds;
+
+	//Create Weighted Blended Transparency Buffers
+	m_pAccumulation = new float[width * height * 4];
+	m_pRevealage = new float[width * height];
+	std::fill_n(m_pAccumulation, width * height * 4, 0.f);
+	std::fill_n(m_pRevealage, width * height, 1.f);
+
+	m_FrameBuffer.pAccumulation = m_pAccumulation;
+	m_FrameBuffer.pRevealage = m_pRevealage;
+
+	//Create Workers + their per frame memory
+	m_pThreadPool = new ThreadPool(numThreads);
+	m_pFrameArena = new FrameArena(m_FrameArenaCapacity);
+
+	//Initialize Scene
+	m_pScene = new Scene(nullptr, m_FrameBuffer);
+}
+
+
+//-----------------------------------------------------------------
+// Destructor
+//-----------------------------------------------------------------
+HeadlessRenderer::~HeadlessRenderer()
+{
+	delete m_pScene;
+	delete m_pFrameArena;
+	delete m_pThreadPool;
+	delete[] m_pRevealage;
+	delete[] m_pAccumulation;
+	delete[] m_pTriangleIds;
+	delete m_pHiZBuffer;
+	delete[] m_pDepthBufferPixels;
+	delete[] m_pColorBufferPixels;
+}
+
+
+//-----------------------------------------------------------------
+// Public Member Functions
+//-----------------------------------------------------------------
+void HeadlessRenderer::Update(const Timer* pTimer)
+{
+	m_pScene->Update(pTimer);
+}
+
+void HeadlessRenderer::Render() const
+{
+	//1. Start of the frame: transient memory of the last frame is given back
+	m_pFrameArena->Reset();
+	const uint64_t numAllocations{ AllocationCounter::GetCount() };
+
+	//2. Clear Background Color
+	const uint32_t clearColor = m_FrameBuffer.MapRGB(
+		static_cast<uint8_t>(m_ClearColorSoftware.r * 255),
+		static_cast<uint8_t>(m_ClearColorSoftware.g * 255),
+		static_cast<uint8_t>(m_ClearColorSoftware.b * 255));
+	std::fill_n(m_FrameBuffer.pPixels, m_FrameBuffer.width * m_FrameBuffer.height, clearColor);
+
+	//3. Clear DepthBuffer
+	std::fill_n(m_FrameBuffer.pDepthPixels, m_FrameBuffer.width * m_FrameBuffer.height, FLT_MAX);
+	m_FrameBuffer.pHiZBuffer->Clear(FLT_MAX);
+
+	//4. Render Scene
+	m_pScene->RenderSoftware(m_FrameBuffer, *m_pThreadPool, *m_pFrameArena);
+
+	//5. Once warmed up, frames that fit in the arena must not allocate
+	m_NumFrameAllocations = AllocationCounter::GetCount() - numAllocations;
+	[[maybe_unused]] const bool isFirstFrame{ m_NumFrames++ == 0 };
+	assert((isFirstFrame || m_pFrameArena->HasOverflowed() || m_NumFrameAllocations == 0) && "Heap allocation in a steady state frame");
+}
+
+bool HeadlessRenderer::SaveFrame(const std::string& path) const
+{
+	//Binary PPM, no image library needed
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	file << "P6\n" << m_FrameBuffer.width << " " << m_FrameBuffer.height << "\n255\n";
+
+	const int numPixels = m_FrameBuffer.width * m_FrameBuffer.height;
+	for (int i{}; i < numPixels; ++i)
+	{
+		const uint32_t pixel = m_FrameBuffer.pPixels[i];
+		const char rgb[3]
+		{
+			static_cast<char>(pixel >> m_FrameBuffer.redShift),
+			static_cast<char>(pixel >> m_FrameBuffer.greenShift),
+			static_cast<char>(pixel >> m_FrameBuffer.blueShift)
+		};
+		file.write(rgb, 3);
+	}
+
+	return file.good();
+}
+
+
+//-----------------------------------------------------------------
+// Private Member Functions
+//-----------------------------------------------------------------
@@ -0,0 +1,63 @@
+#pragma once
+// Includes
+#include "DataTypes.h"
+
+namespace dae
+{
+	// Class Forward Declarations
+	class Scene;
+	class ThreadPool;
+	class FrameArena;
+
+	// Class Declaration
+	class HeadlessRenderer final
+	{
+	public:
+		// Constructors and Destructor
+		explicit HeadlessRenderer(int width, int height, uint32_t numThreads);
+		~HeadlessRenderer();
+
+		// Copy and Move semantics
+		HeadlessRenderer(const HeadlessRenderer& other)					= delete;
+		HeadlessRenderer& operator=(const HeadlessRenderer& other)		= delete;
+		HeadlessRenderer(HeadlessRenderer&& other) noexcept				= delete;
+		HeadlessRenderer& operator=(HeadlessRenderer&& other) noexcept	= delete;
+
+		//---------------------------
+		// Public Member Functions
+		//---------------------------
+		void Update(const Timer* pTimer);
+		void Render() const;
+		bool SaveFrame(const std::string& path) const;
+
+		Scene* GetScene() const { return m_pScene; }
+		const FrameBuffer& GetFrameBuffer() const { return m_FrameBuffer; }
+		uint64_t GetNumFrameAllocations() const { return m_NumFrameAllocations; }
+
+
+	private:
+		// Member variables
+		Scene* m_pScene{};
+
+		uint32_t* m_pColorBufferPixels{};
+		float* m_pDepthBufferPixels{};
+		HiZBuffer* m_pHiZBuffer{};
+		uint32_t* m_pTriangleIds{};
+		float* m_pAccumulation{};
+		float* m_pRevealage{};
+		FrameBuffer m_FrameBuffer{};
+		ThreadPool* m_pThreadPool{};
+
+		FrameArena* m_pFrameArena{};
+		const size_t m_FrameArenaCapacity{ 8 * 1024 * 1024 }; //Initial size, grows to fit the largest frame
+		mutable uint64_t m_NumFrameAllocations{};
+		mutable uint32_t m_NumFrames{}; //The first frame fills the arena and may allocate
+
+		const ColorRGB m_ClearColorSoftware{ 0.39f, 0.39f, 0.39f };
+
+		//---------------------------
+		// Private Member Functions
+		//---------------------------
+
+	};
+}
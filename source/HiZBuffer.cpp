@@ -0,0 +1,154 @@
+//-----------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------
+#include "pch.h"
+#include "HiZBuffer.h"
+
+using namespace dae;
+
+
+//-----------------------------------------------------------------
+// Constructors
+//-----------------------------------------------------------------
+HiZBuffer::HiZBuffer(int width, int height)
+	: m_Width{ width }
+	, m_Height{ height }
+{
+	m_NumBlocksX = (width + blockSize - 1) / blockSize;
+	m_NumBlocksY = (height + blockSize - 1) / blockSize;
+	m_NumTilesX = (width + tileSize - 1) / tileSize;
+	m_NumTilesY = (height + tileSize - 1) / tileSize;
+
+	m_pBlockMaxDepth = new float[m_NumBlocksX * m_NumBlocksY];
+	m_pIsBlockDirty = new uint8_t[m_NumBlocksX * m_NumBlocksY];
+	m_pTileMaxDepth = new float[m_NumTilesX * m_NumTilesY];
+	m_pIsTileDirty = new uint8_t[m_NumTilesX * m_NumTilesY];
+
+	Clear(FLT_MAX);
+}
+
+
+//-----------------------------------------------------------------
+// Destructor
+//-----------------------------------------------------------------
+HiZBuffer::~HiZBuffer()
+{
+	delete[] m_pBlockMaxDepth;
+	delete[] m_pIsBlockDirty;
+	delete[] m_pTileMaxDepth;
+	delete[] m_pIsTileDirty;
+}
+
+
+//-----------------------------------------------------------------
+// Public Member Functions
+//-----------------------------------------------------------------
+void HiZBuffer::Clear(float depth)
+{
+	std::fill_n(m_pBlockMaxDepth, m_NumBlocksX * m_NumBlocksY, depth);
+	std::fill_n(m_pIsBlockDirty, m_NumBlocksX * m_NumBlocksY, uint8_t{});
+	std::fill_n(m_pTileMaxDepth, m_NumTilesX * m_NumTilesY, depth);
+	std::fill_n(m_pIsTileDirty, m_NumTilesX * m_NumTilesY, uint8_t{});
+}
+
+void HiZBuffer::MarkDirty(const Int2& min, const Int2& max)
+{
+	const int blockLeft{ min.x / blockSize };
+	const int blockTop{ min.y / blockSize };
+	const int blockRight{ (max.x - 1) / blockSize };
+	const int blockBottom{ (max.y - 1) / blockSize };
+
+	for (int blockY{ blockTop }; blockY <= blockBottom; ++blockY)
+	{
+		std::fill_n(m_pIsBlockDirty + blockLeft + (blockY * m_NumBlocksX), blockRight - blockLeft + 1, uint8_t{ 1 });
+	}
+
+	for (int tileY{ blockTop / m_BlocksPerTile }; tileY <= blockBottom / m_BlocksPerTile; ++tileY)
+	{
+		for (int tileX{ blockLeft / m_BlocksPerTile }; tileX <= blockRight / m_BlocksPerTile; ++tileX)
+		{
+			m_pIsTileDirty[tileX + (tileY * m_NumTilesX)] = 1;
+		}
+	}
+}
+
+float HiZBuffer::GetBlockMaxDepth(const float* pDepthBuffer, int blockX, int blockY)
+{
+	const int blockIndex{ blockX + (blockY * m_NumBlocksX) };
+	if (!m_pIsBlockDirty[blockIndex])
+		return m_pBlockMaxDepth[blockIndex];
+
+	//Rebuild from the depth buffer
+	const int left{ blockX * blockSize };
+	const int top{ blockY * blockSize };
+	const int right{ std::min(left + blockSize, m_Width) };
+	const int bottom{ std::min(top + blockSize, m_Height) };
+
+	float maxDepth{ 0.f };
+	for (int py{ top }; py < bottom; ++py)
+	{
+		const float* pDepthRow{ pDepthBuffer + (py * m_Width) };
+		for (int px{ left }; px < right; ++px)
+		{
+			maxDepth = pDepthRow[px] > maxDepth ? pDepthRow[px] : maxDepth;
+		}
+	}
+
+	m_pBlockMaxDepth[blockIndex] = maxDepth;
+	m_pIsBlockDirty[blockIndex] = 0;
+
+	return maxDepth;
+}
+
+float HiZBuffer::GetTileMaxDepth(const float* pDepthBuffer, int tileX, int tileY)
+{
+	const int tileIndex{ tileX + (tileY * m_NumTilesX) };
+	if (!m_pIsTileDirty[tileIndex])
+		return m_pTileMaxDepth[tileIndex];
+
+	//Rebuild from the blocks
+	const int blockLeft{ tileX * m_BlocksPerTile };
+	const int blockTop{ tileY * m_BlocksPerTile };
+	const int blockRight{ std::min(blockLeft + m_BlocksPerTile, m_NumBlocksX) };
+	const int blockBottom{ std::min(blockTop + m_BlocksPerTile, m_NumBlocksY) };
+
+	float maxDepth{ 0.f };
+	for (int blockY{ blockTop }; blockY < blockBottom; ++blockY)
+	{
+		for (int blockX{ blockLeft }; blockX < blockRight; ++blockX)
+		{
+			maxDepth = std::max(maxDepth, GetBlockMaxDepth(pDepthBuffer, blockX, blockY));
+		}
+	}
+
+	m_pTileMaxDepth[tileIndex] = maxDepth;
+	m_pIsTileDirty[tileIndex] = 0;
+
+	return maxDepth;
+}
+
+float HiZBuffer::GetMaxDepth(const float* pDepthBuffer, const Int2& min, const Int2& max)
+{
+	//A whole tile is answered by the tile level
+	const int tileX{ min.x / tileSize };
+	const int tileY{ min.y / tileSize };
+	if (min.x == tileX * tileSize && min.y == tileY * tileSize &&
+		max.x == std::min((tileX + 1) * tileSize, m_Width) && max.y == std::min((tileY + 1) * tileSize, m_Height))
+		return GetTileMaxDepth(pDepthBuffer, tileX, tileY);
+
+	const int blockLeft{ min.x / blockSize };
+	const int blockTop{ min.y / blockSize };
+	const int blockRight{ (max.x - 1) / blockSize };
+	const int blockBottom{ (max.y - 1) / blockSize };
+
+	float maxDepth{ 0.f };
+	for (int blockY{ blockTop }; blockY <= blockBottom; ++blockY)
+	{
+		for (int blockX{ blockLeft }; blockX <= blockRight; ++blockX)
+		{
+			maxDepth = std::max(maxDepth, GetBlockMaxDepth(pDepthBuffer, blockX, blockY));
+		}
+	}
+
+	return maxDepth;
+}
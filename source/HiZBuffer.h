@@ -0,0 +1,63 @@
+#pragma once
+// Includes
+
+namespace dae
+{
+	// Class Declaration
+	//Coarse max-depth pyramid on top of a full resolution depth buffer: one level per block, one per tile
+	//Every tile is only ever touched by the thread rasterizing it, so no locking is needed
+	class HiZBuffer final
+	{
+	public:
+		// Constructors and Destructor
+		explicit HiZBuffer(int width, int height);
+		~HiZBuffer();
+
+		// Copy and Move semantics
+		HiZBuffer(const HiZBuffer& other)					= delete;
+		HiZBuffer& operator=(const HiZBuffer& other)		= delete;
+		HiZBuffer(HiZBuffer&& other) noexcept				= delete;
+		HiZBuffer& operator=(HiZBuffer&& other) noexcept	= delete;
+
+		//Level sizes in pixels, the software rasterizer bins and classifies with the same sizes
+		static constexpr int blockSize{ 8 };
+		static constexpr int tileSize{ 64 };
+		static_assert(tileSize % blockSize == 0, "Blocks must not cross tiles");
+
+		//---------------------------
+		// Public Member Functions
+		//---------------------------
+		void Clear(float depth);
+
+		//Pixels in [min, max) may have been written, their blocks and tiles get rebuilt when they are needed again
+		void MarkDirty(const Int2& min, const Int2& max);
+
+		//Farthest depth stored in the pixels of a block/tile or of every block overlapping [min, max)
+		float GetBlockMaxDepth(const float* pDepthBuffer, int blockX, int blockY);
+		float GetTileMaxDepth(const float* pDepthBuffer, int tileX, int tileY);
+		float GetMaxDepth(const float* pDepthBuffer, const Int2& min, const Int2& max);
+
+
+	private:
+		// Member variables
+		int m_Width{};
+		int m_Height{};
+		static constexpr int m_BlocksPerTile{ tileSize / blockSize };
+
+		int m_NumBlocksX{};
+		int m_NumBlocksY{};
+		int m_NumTilesX{};
+		int m_NumTilesY{};
+
+		float* m_pBlockMaxDepth{};
+		uint8_t* m_pIsBlockDirty{};
+
+		float* m_pTileMaxDepth{};
+		uint8_t* m_pIsTileDirty{};
+
+		//---------------------------
+		// Private Member Functions
+		//---------------------------
+
+	};
+}
@@ -3,6 +3,7 @@
 //-----------------------------------------------------------------
 #include "pch.h"
 #include "Material.h"
+#include "ThreadPool.h"
 #include <cassert>
 
 using namespace dae;
@@ -11,6 +12,11 @@ using namespace dae;
 //-----------------------------------------------------------------
 // Constructors
 //-----------------------------------------------------------------
+Material::Material()
+{
+}
+
+#if !defined(HEADLESS)
 Material::Material(ID3D11Device* pDevice, const std::wstring& assetFile)
 {
 	//Load Effect
@@ -39,6 +45,25 @@ Material::Material(ID3D11Device* pDevice, const std::wstring& assetFile)
 		std::wcout << L"Matrix Variable gWorldViewProj not valid\n";
 
 
+	//Load Rasterizer States (one per CullMode)
+	m_pRasterizerStateVariable = m_pEffect->GetVariableByName("gRasterizerState")->AsRasterizer();
+	if (!m_pRasterizerStateVariable->IsValid())
+		std::wcout << L"RasterizerState Variable gRasterizerState not valid\n";
+
+	const D3D11_CULL_MODE cullModes[]{ D3D11_CULL_BACK, D3D11_CULL_FRONT, D3D11_CULL_NONE };
+	for (int i{}; i < static_cast<int>(CullMode::END); ++i)
+	{
+		D3D11_RASTERIZER_DESC rasterizerDesc{};
+		rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+		rasterizerDesc.CullMode = cullModes[i];
+		rasterizerDesc.FrontCounterClockwise = false;
+		rasterizerDesc.DepthClipEnable = true;
+
+		if (FAILED(pDevice->CreateRasterizerState(&rasterizerDesc, &m_pRasterizerStates[i])))
+			std::wcout << L"RasterizerState not valid\n";
+	}
+
+
 	//Create Vertex Layout
 	static constexpr uint32_t numElements{ 4 };
 	D3D11_INPUT_ELEMENT_DESC vertexDesc[numElements]{};
@@ -77,6 +102,7 @@ Material::Material(ID3D11Device* pDevice, const std::wstring& assetFile)
 	if (FAILED(result))
 		assert(false);
 }
+#endif
 
 
 //-----------------------------------------------------------------
@@ -84,20 +110,29 @@ Material::Material(ID3D11Device* pDevice, const std::wstring& assetFile)
 //-----------------------------------------------------------------
 Material::~Material()
 {
+#if !defined(HEADLESS)
 	if (m_pMatWorldViewProjVariable) m_pMatWorldViewProjVariable->Release();
 
+	if (m_pRasterizerStateVariable) m_pRasterizerStateVariable->Release();
+	for (ID3D11RasterizerState* pRasterizerState : m_pRasterizerStates)
+	{
+		if (pRasterizerState) pRasterizerState->Release();
+	}
+
 	if (m_pTechniquePoint) m_pTechniquePoint->Release();
 	if (m_pTechniqueLinear) m_pTechniqueLinear->Release();
 	if (m_pTechniqueAnisotropic) m_pTechniqueAnisotropic->Release();
 
 	if (m_pInputLayout) m_pInputLayout->Release();
 	if (m_pEffect) m_pEffect->Release();
+#endif
 }
 
 
 //-----------------------------------------------------------------
 // Public Member Functions
 //-----------------------------------------------------------------
+#if !defined(HEADLESS)
 ID3DX11Effect* Material::LoadEffect(ID3D11Device* pDevice, const std::wstring& assetFile)
 {
 	HRESULT result;
@@ -148,31 +183,35 @@ ID3DX11Effect* Material::LoadEffect(ID3D11Device* pDevice, const std::wstring& a
 
 	return pEffect;
 }
+#endif
+
+void Material::SetCullMode([[maybe_unused]] CullMode cullMode)
+{
+#if !defined(HEADLESS)
+	ID3D11RasterizerState* pRasterizerState{ m_pRasterizerStates[static_cast<int>(cullMode)] };
+	if (m_pRasterizerStateVariable && pRasterizerState)
+		m_pRasterizerStateVariable->SetRasterizerState(0, pRasterizerState);
+#endif
+}
 
 std::string Material::CycleTechnique()
 {
-	m_TechniqueType = TechniqueType(((int)m_TechniqueType + 1) % (int)TechniqueType::END);
+	m_SamplerFilter = SamplerFilter(((int)m_SamplerFilter + 1) % (int)SamplerFilter::END);
 
-	switch (m_TechniqueType)
+	//The software rasterizer only needs the filter, headless builds have no techniques
+	switch (m_SamplerFilter)
 	{
-	case TechniqueType::Point:
-		if (m_pTechniquePoint)
-		{
-			m_pTechnique = m_pTechniquePoint;
-			return "POINT";
-		} break;
-	case TechniqueType::Linear:
-		if (m_pTechniqueLinear)
-		{
-			m_pTechnique = m_pTechniqueLinear;
-			return "LINEAR";
-		} break;
-	case TechniqueType::Anisotropic:
-		if (m_pTechniqueAnisotropic)
-		{
-			m_pTechnique = m_pTechniqueAnisotropic;
-			return "ANISOTROPIC";
-		} break;
+	case SamplerFilter::Point:
+		if (m_pTechniquePoint) m_pTechnique = m_pTechniquePoint;
+		return "POINT";
+	case SamplerFilter::Linear:
+		if (m_pTechniqueLinear) m_pTechnique = m_pTechniqueLinear;
+		return "LINEAR";
+	case SamplerFilter::Anisotropic:
+		if (m_pTechniqueAnisotropic) m_pTechnique = m_pTechniqueAnisotropic;
+		return "ANISOTROPIC";
+	case SamplerFilter::END:
+		break;
 	}
 
 	return "";
@@ -184,15 +223,92 @@ void Material::SetMatrix(Matrix& matrix, const std::string& name)
 	{
 		m_WorldViewProjMat = matrix;
 
+#if !defined(HEADLESS)
 		if (m_pMatWorldViewProjVariable)
 			m_pMatWorldViewProjVariable->SetMatrix(reinterpret_cast<float*>(&matrix));
 		else
 			std::wcout << L"SetMatrix m_pMatWorldViewProjVariable failed\n";
+#endif
 	}
 }
 
+void Material::VertexShading(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, const std::vector<uint8_t>& isVertexUsed, ThreadPool& threadPool) const
+{
+	ShadeUsedVertices(vertices_in, vertices_out, isVertexUsed, threadPool, false);
+}
+
+void Material::VertexPositionShading(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, const std::vector<uint8_t>& isVertexUsed, ThreadPool& threadPool) const
+{
+	ShadeUsedVertices(vertices_in, vertices_out, isVertexUsed, threadPool, true);
+}
+
+void Material::VertexAttributeShading(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, uint32_t first, uint32_t last) const
+{
+	ShadeAttributes(vertices_in, vertices_out, first, last);
+}
+
+Material::PixelShader Material::GetPixelShader() const
+{
+	return { this, [](const Material& material, const PixelLanes& lanes, int pixelMask, ColorRGB* pColors, float* pAlphas) { return material.PixelShading(lanes, pixelMask, pColors, pAlphas); } };
+}
+
 
 //-----------------------------------------------------------------
 // Protected Member Functions
 //-----------------------------------------------------------------
+void Material::ShadeUsedVertices(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, const std::vector<uint8_t>& isVertexUsed, ThreadPool& threadPool, bool isPositionOnly) const
+{
+	//vertices_out holds one (uninitialized) entry per input vertex in every stream
+	const uint32_t numVertices{ static_cast<uint32_t>(vertices_in.size()) };
+	const uint32_t numBatches{ (numVertices + m_VertexBatchSize - 1) / m_VertexBatchSize };
+
+	threadPool.ParallelFor(numBatches, [&](uint32_t batch)
+		{
+			const uint32_t batchEnd{ std::min((batch + 1) * m_VertexBatchSize, numVertices) };
+
+			uint32_t first{ batch * m_VertexBatchSize };
+			while (first < batchEnd)
+			{
+				//1. Vertices of culled triangles are never read
+				while (first < batchEnd && !isVertexUsed[first]) ++first;
+				if (first == batchEnd) break;
+
+				//2. Extend the run until a long enough gap of unused vertices
+				uint32_t last{ first + 1 };
+				for (uint32_t i{ last }, gap{}; i < batchEnd && gap < m_MaxVertexGap; ++i)
+				{
+					if (!isVertexUsed[i]) { ++gap; continue; }
+
+					last = i + 1;
+					gap = 0;
+				}
+
+				ShadePositions(vertices_in, vertices_out, first, last);
+				if (!isPositionOnly) ShadeAttributes(vertices_in, vertices_out, first, last);
+
+				first = last;
+			}
+		});
+}
+
+void Material::ShadePositions(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, uint32_t first, uint32_t last) const
+{
+	// Variables
+	const Vertex* pFirst{ vertices_in.data() + first };
+	const size_t count{ last - first };
+
+	//Clip space, the mesh clips triangles before the perspective divide
+	m_WorldViewProjMat.TransformPoints(&pFirst->position, sizeof(Vertex), count,
+		vertices_out.pPositionX + first, vertices_out.pPositionY + first, vertices_out.pPositionZ + first, vertices_out.pPositionW + first);
+}
+
+void Material::ShadeAttributes(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, uint32_t first, uint32_t last) const
+{
+	//Pass through, the mesh skips the planes of the other streams (HasSurfaceAttributes)
+	for (uint32_t i{ first }; i < last; ++i)
+	{
+		vertices_out.pUvX[i] = vertices_in[i].uv.x;
+		vertices_out.pUvY[i] = vertices_in[i].uv.y;
+	}
+}
 
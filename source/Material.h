@@ -6,13 +6,29 @@ namespace dae
 {
 	// Class Forward Declarations
 	class Texture;
+	class ThreadPool;
 	
 	// Class Declaration
 	class Material
 	{
 	public:
+		//Pixel shader with the current state of its material compiled in, fetched once per draw:
+		//calling it costs no virtual call and no branches on the shading state, only one indirect call per batch of pixels
+		struct PixelShader
+		{
+			using Function = int(*)(const Material& material, const PixelLanes& lanes, int pixelMask, ColorRGB* pColors, float* pAlphas);
+
+			const Material* pMaterial{};
+			Function pFunction{};
+
+			int operator()(const PixelLanes& lanes, int pixelMask, ColorRGB* pColors, float* pAlphas) const { return pFunction(*pMaterial, lanes, pixelMask, pColors, pAlphas); }
+		};
+
 		// Constructors and Destructor
+		explicit Material();
+#if !defined(HEADLESS)
 		explicit Material(ID3D11Device* pDevice, const std::wstring& assetFile);
+#endif
 		virtual ~Material();
 		
 		// Copy and Move semantics
@@ -24,7 +40,9 @@ namespace dae
 		//---------------------------
 		// Public Member Functions
 		//---------------------------
+#if !defined(HEADLESS)
 		static ID3DX11Effect* LoadEffect(ID3D11Device* pDevice, const std::wstring& assetFile);
+#endif
 
 		virtual void SetMatrix(Matrix& matrix, const std::string& name);
 		virtual void SetTexture(Texture* pTexture, const std::string& name) {};
@@ -33,12 +51,24 @@ namespace dae
 		ID3DX11EffectTechnique* GetTechnique() const { return m_pTechnique; }
 		ID3D11InputLayout* GetInputLayout() const { return m_pInputLayout; }
 		
-		//HARDWARE
+		//SHARED
+		void SetCullMode(CullMode cullMode);
 		std::string CycleTechnique();
+		SamplerFilter GetSamplerFilter() const { return m_SamplerFilter; }
 
 		//SOFTWARE
-		virtual void VertexShading(const std::vector<Vertex>& vertices_in, std::vector<Vertex_Out>& vertices_out) {};
-		virtual ColorRGB PixelShading(const Vertex_Out& v) { return ColorRGB(); };
+		//Only the vertices flagged in isVertexUsed get shaded, vertices_out has room for (and keeps the indices of) vertices_in
+		void VertexShading(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, const std::vector<uint8_t>& isVertexUsed, ThreadPool& threadPool) const;
+		//Lazy vertex shading: first only the positions of the used vertices, the other attributes of [first, last) once a triangle using them survives culling
+		void VertexPositionShading(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, const std::vector<uint8_t>& isVertexUsed, ThreadPool& threadPool) const;
+		void VertexAttributeShading(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, uint32_t first, uint32_t last) const;
+		//Shades a batch of pixels: pColors[lane] for every lane in pixelMask, the other lanes hold no valid inputs
+		//pAlphas comes in opaque (1), only blended materials overwrite it. Returns the lanes of pixelMask that were not discarded (none for the base material)
+		virtual int PixelShading(const PixelLanes&, int, ColorRGB*, float*) const { return 0; };
+		//Materials without specialized shaders fall back to PixelShading
+		virtual PixelShader GetPixelShader() const;
+		//Normals, tangents and world positions are only shaded and interpolated for materials that read them
+		bool HasSurfaceAttributes() const { return m_HasSurfaceAttributes; }
 
 	
 	protected:
@@ -54,19 +84,26 @@ namespace dae
 		ID3DX11EffectMatrixVariable* m_pMatWorldViewProjVariable{};
 		Matrix m_WorldViewProjMat{};
 
-		enum class TechniqueType
-		{
-			Point,
-			Linear,
-			Anisotropic,
+		ID3DX11EffectRasterizerVariable* m_pRasterizerStateVariable{};
+		ID3D11RasterizerState* m_pRasterizerStates[static_cast<int>(CullMode::END)]{}; //[CullMode]
+
+		//Picks the technique (hardware) and how textures get filtered (software)
+		SamplerFilter m_SamplerFilter{};
+
+		//Set by materials whose pixel shader reads the normal, tangent and world streams
+		bool m_HasSurfaceAttributes{ false };
 
-			//@END
-			END
-		} m_TechniqueType{};
+		//Vertices per job of the vertex stage, unused gaps shorter than a SIMD batch are shaded along instead of splitting it
+		static constexpr uint32_t m_VertexBatchSize{ 1024 };
+		static constexpr uint32_t m_MaxVertexGap{ 8 };
 	
 		//---------------------------
 		// Protected Member Functions
 		//---------------------------
+		void ShadeUsedVertices(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, const std::vector<uint8_t>& isVertexUsed, ThreadPool& threadPool, bool isPositionOnly) const;
+		void ShadePositions(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, uint32_t first, uint32_t last) const;
+		//Everything but the position, the base material only passes the uv through and leaves the other streams unwritten
+		virtual void ShadeAttributes(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, uint32_t first, uint32_t last) const;
 	
 	};
 }
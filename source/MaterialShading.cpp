@@ -5,16 +5,56 @@
 #include "MaterialShading.h"
 #include "Texture.h"
 #include "Utils.h"
+#include "SIMD.h"
 
 using namespace dae;
 
 
+namespace
+{
+	//Unit length copy of one vector per lane, rounded like Vector3::Normalized (sqrt and division are exact in SIMD too)
+	void NormalizeLanes(const float* pX, const float* pY, const float* pZ, float* pOutX, float* pOutY, float* pOutZ)
+	{
+		int lane{};
+#if defined(DAE_SIMD_X64)
+		for (; lane + 4 <= PixelLanes::size; lane += 4)
+		{
+			const __m128 x{ _mm_loadu_ps(pX + lane) };
+			const __m128 y{ _mm_loadu_ps(pY + lane) };
+			const __m128 z{ _mm_loadu_ps(pZ + lane) };
+			const __m128 length{ _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))) };
+
+			_mm_storeu_ps(pOutX + lane, _mm_div_ps(x, length));
+			_mm_storeu_ps(pOutY + lane, _mm_div_ps(y, length));
+			_mm_storeu_ps(pOutZ + lane, _mm_div_ps(z, length));
+		}
+#endif
+		for (; lane < PixelLanes::size; ++lane)
+		{
+			const float length{ sqrtf(pX[lane] * pX[lane] + pY[lane] * pY[lane] + pZ[lane] * pZ[lane]) };
+			pOutX[lane] = pX[lane] / length;
+			pOutY[lane] = pY[lane] / length;
+			pOutZ[lane] = pZ[lane] / length;
+		}
+	}
+}
+
+
 //-----------------------------------------------------------------
 // Constructors
 //-----------------------------------------------------------------
+MaterialShading::MaterialShading()
+	: Material()
+{
+	m_HasSurfaceAttributes = true;
+}
+
+#if !defined(HEADLESS)
 MaterialShading::MaterialShading(ID3D11Device* pDevice, const std::wstring& assetFile)
 	: Material(pDevice, assetFile)
 {
+	m_HasSurfaceAttributes = true;
+
 	//Load Matrices
 	m_pMatWorldVariable = m_pEffect->GetVariableByName("gWorld")->AsMatrix();
 	if (!m_pMatWorldVariable->IsValid())
@@ -42,6 +82,7 @@ MaterialShading::MaterialShading(ID3D11Device* pDevice, const std::wstring& asse
 	if (!m_pGlossMapVariable->IsValid())
 		std::wcout << L"Shader Resource gGlossMap Variable not valid\n";
 }
+#endif
 
 
 //-----------------------------------------------------------------
@@ -54,6 +95,7 @@ MaterialShading::~MaterialShading()
 	delete m_pSpecularTexture;
 	delete m_pGlossTexture;
 
+#if !defined(HEADLESS)
 	if (m_pGlossMapVariable) m_pGlossMapVariable->Release();
 	if (m_pSpecularMapVariable) m_pSpecularMapVariable->Release();
 	if (m_pNormalMapVariable) m_pNormalMapVariable->Release();
@@ -61,6 +103,7 @@ MaterialShading::~MaterialShading()
 
 	if (m_pMatInvViewVariable) m_pMatInvViewVariable->Release();
 	if (m_pMatWorldVariable) m_pMatWorldVariable->Release();
+#endif
 }
 
 
@@ -103,83 +146,14 @@ void MaterialShading::SetTexture(Texture* pTexture, const std::string& name)
 	}
 }
 
-void MaterialShading::VertexShading(const std::vector<Vertex>& vertices_in, std::vector<Vertex_Out>& vertices_out)
+int MaterialShading::PixelShading(const PixelLanes& lanes, int pixelMask, ColorRGB* pColors, float* pAlphas) const
 {
-	vertices_out.clear();
-	vertices_out.reserve(vertices_in.size());
-
-	for (int i{}; i < vertices_in.size(); ++i)
-	{
-		//Create temporary variable
-		Vertex_Out v{};
-
-		//Position calculations
-		v.position = m_WorldViewProjMat.TransformPoint({ vertices_in[i].position, 1.f });
-
-		v.position.x /= v.position.w;
-		v.position.y /= v.position.w;
-		v.position.z /= v.position.w;
-
-		//Set other variables
-		v.uv = vertices_in[i].uv;
-		v.normal = m_WorldMat.TransformVector(vertices_in[i].normal);
-		v.tangent = m_WorldMat.TransformVector(vertices_in[i].tangent);
-		v.worldPosition = Vector3(m_WorldMat.TransformPoint({ vertices_in[i].position, 1.f }));
-
-		//Add the new temporary variable to the list
-		vertices_out.emplace_back(v);
-	}
+	return GetPixelShader()(lanes, pixelMask, pColors, pAlphas);
 }
 
-ColorRGB MaterialShading::PixelShading(const Vertex_Out& v)
+Material::PixelShader MaterialShading::GetPixelShader() const
 {
-	//Pre defined variables
-	Vector3 lightDirection{ .577f, -.577f, .577f };
-	float lightIntensity{ 7.f };
-	float shininess{ 25.f };
-	ColorRGB finalColor{ 0.025f, 0.025f, 0.025f };
-
-	Vector3 normal{ v.normal };
-	Vector3 viewDirection = (v.worldPosition - m_InvViewMat[3].GetXYZ()).Normalized();
-
-	//Normal map
-	if (m_IsNormalMap)
-	{
-		Vector3 binormal = Vector3::Cross(v.normal, v.tangent);
-		Matrix tangentSpaceAxis{ v.tangent, binormal, v.normal, Vector3::Zero };
-
-		ColorRGB sampledColor = m_pNormalTexture->Sample(v.uv);
-		sampledColor = (2.f * sampledColor) - ColorRGB{ 1.f, 1.f, 1.f };
-
-		normal = tangentSpaceAxis.TransformVector(sampledColor.r, sampledColor.g, sampledColor.b);
-	}
-
-	//Observed area (lambert cosine law)
-	float dotProduct = normal * -lightDirection;
-	if (dotProduct >= 0.f)
-	{
-		switch (m_ShadingMode)
-		{
-		case ShadingMode::ObservedArea:
-			finalColor += { dotProduct, dotProduct, dotProduct };
-			break;
-
-		case ShadingMode::Diffuse:
-			finalColor += BRDF::Lambert(lightIntensity, m_pDiffuseTexture->Sample(v.uv)) * dotProduct;
-			break;
-
-		case ShadingMode::Specular:
-			finalColor += BRDF::Phong(m_pSpecularTexture->Sample(v.uv), shininess * m_pGlossTexture->Sample(v.uv).r, -lightDirection, viewDirection, normal) * dotProduct;
-			break;
-
-		case ShadingMode::Combined:
-			finalColor += BRDF::Lambert(lightIntensity, m_pDiffuseTexture->Sample(v.uv)) * dotProduct;
-			finalColor += BRDF::Phong(m_pSpecularTexture->Sample(v.uv), shininess * m_pGlossTexture->Sample(v.uv).r, -lightDirection, viewDirection, normal) * dotProduct;
-			break;
-		}
-	}
-
-	return finalColor;
+	return { this, m_PixelShaders[static_cast<int>(m_ShadingMode)][m_IsNormalMap] };
 }
 
 std::string MaterialShading::CycleShading()
@@ -199,6 +173,9 @@ std::string MaterialShading::CycleShading()
 
 	case ShadingMode::Combined:
 		return "COMBINED";
+
+	case ShadingMode::END:
+		break;
 	}
 
 	return "";
@@ -210,37 +187,76 @@ bool MaterialShading::ToggleNormalMap()
 }
 
 
+//-----------------------------------------------------------------
+// Static Member Variables
+//-----------------------------------------------------------------
+const Material::PixelShader::Function MaterialShading::m_PixelShaders[static_cast<int>(ShadingMode::END)][2]
+{
+	{ &ShadePixels<ShadingMode::ObservedArea, false>, &ShadePixels<ShadingMode::ObservedArea, true> },
+	{ &ShadePixels<ShadingMode::Diffuse, false>, &ShadePixels<ShadingMode::Diffuse, true> },
+	{ &ShadePixels<ShadingMode::Specular, false>, &ShadePixels<ShadingMode::Specular, true> },
+	{ &ShadePixels<ShadingMode::Combined, false>, &ShadePixels<ShadingMode::Combined, true> },
+};
+
+
 //-----------------------------------------------------------------
 // Private Member Functions
 //-----------------------------------------------------------------
+void MaterialShading::ShadeAttributes(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, uint32_t first, uint32_t last) const
+{
+	// Variables
+	const Vertex* pFirst{ vertices_in.data() + first };
+	const size_t count{ last - first };
+
+	//1. World space
+	m_WorldMat.TransformPoints(&pFirst->position, sizeof(Vertex), count, vertices_out.pWorldX + first, vertices_out.pWorldY + first, vertices_out.pWorldZ + first);
+	m_WorldMat.TransformVectors(&pFirst->normal, sizeof(Vertex), count, vertices_out.pNormalX + first, vertices_out.pNormalY + first, vertices_out.pNormalZ + first);
+	m_WorldMat.TransformVectors(&pFirst->tangent, sizeof(Vertex), count, vertices_out.pTangentX + first, vertices_out.pTangentY + first, vertices_out.pTangentZ + first);
+
+	//2. Pass through
+	for (uint32_t i{ first }; i < last; ++i)
+	{
+		vertices_out.pUvX[i] = vertices_in[i].uv.x;
+		vertices_out.pUvY[i] = vertices_in[i].uv.y;
+	}
+}
+
 void MaterialShading::SetWorldMatrix(Matrix& matrix)
 {
 	m_WorldMat = matrix;
 
+#if !defined(HEADLESS)
 	if (m_pMatWorldVariable)
 		m_pMatWorldVariable->SetMatrix(reinterpret_cast<float*>(&matrix));
 	else
 		std::wcout << L"SetMatrix m_pMatWorldVariable failed\n";
+#endif
 }
 
 void MaterialShading::SetInverseViewMatrix(Matrix& matrix)
 {
 	m_InvViewMat = matrix;
 
+#if !defined(HEADLESS)
 	if (m_pMatInvViewVariable)
 		m_pMatInvViewVariable->SetMatrix(reinterpret_cast<float*>(&matrix));
 	else
 		std::wcout << L"SetMatrix m_pMatInvViewVariable failed\n";
+#endif
 }
 
 void MaterialShading::SetDiffuse(Texture* pTexture)
 {
 	if (pTexture == nullptr)
 		std::wcout << L"SetDiffuse failed: nullptr given\n";
-	else if (m_pDiffuseMapVariable)
+	else
 	{
 		m_pDiffuseTexture = pTexture;
-		m_pDiffuseMapVariable->SetResource(pTexture->GetResourceView());
+
+#if !defined(HEADLESS)
+		if (m_pDiffuseMapVariable)
+			m_pDiffuseMapVariable->SetResource(pTexture->GetResourceView());
+#endif
 	}
 }
 
@@ -248,10 +264,16 @@ void MaterialShading::SetNormal(Texture* pTexture)
 {
 	if (pTexture == nullptr)
 		std::wcout << L"SetNormal failed: nullptr given\n";
-	else if (m_pNormalMapVariable)
+	else
 	{
 		m_pNormalTexture = pTexture;
-		m_pNormalMapVariable->SetResource(pTexture->GetResourceView());
+		if (m_pDiffuseTexture && !pTexture->HasSameSize(*m_pDiffuseTexture))
+			std::wcout << L"SetNormal: size differs from the diffuse map, the software rasterizer selects mip levels with the diffuse map\n";
+
+#if !defined(HEADLESS)
+		if (m_pNormalMapVariable)
+			m_pNormalMapVariable->SetResource(pTexture->GetResourceView());
+#endif
 	}
 }
 
@@ -259,10 +281,16 @@ void MaterialShading::SetSpecular(Texture* pTexture)
 {
 	if (pTexture == nullptr)
 		std::wcout << L"SetSpecular failed: nullptr given\n";
-	else if (m_pSpecularMapVariable)
+	else
 	{
 		m_pSpecularTexture = pTexture;
-		m_pSpecularMapVariable->SetResource(pTexture->GetResourceView());
+		if (m_pDiffuseTexture && !pTexture->HasSameSize(*m_pDiffuseTexture))
+			std::wcout << L"SetSpecular: size differs from the diffuse map, the software rasterizer selects mip levels with the diffuse map\n";
+
+#if !defined(HEADLESS)
+		if (m_pSpecularMapVariable)
+			m_pSpecularMapVariable->SetResource(pTexture->GetResourceView());
+#endif
 	}
 }
 
@@ -270,10 +298,149 @@ void MaterialShading::SetGlossiness(Texture* pTexture)
 {
 	if (pTexture == nullptr)
 		std::wcout << L"SetGlossiness failed: nullptr given\n";
-	else if (m_pGlossMapVariable)
+	else
 	{
 		m_pGlossTexture = pTexture;
-		m_pGlossMapVariable->SetResource(pTexture->GetResourceView());
+		if (m_pDiffuseTexture && !pTexture->HasSameSize(*m_pDiffuseTexture))
+			std::wcout << L"SetGlossiness: size differs from the diffuse map, the software rasterizer selects mip levels with the diffuse map\n";
+
+#if !defined(HEADLESS)
+		if (m_pGlossMapVariable)
+			m_pGlossMapVariable->SetResource(pTexture->GetResourceView());
+#endif
 	}
 }
 
+template<MaterialShading::ShadingMode shadingMode, bool isNormalMap>
+int MaterialShading::ShadePixels(const Material& material, const PixelLanes& lanes, int pixelMask, ColorRGB* pColors, float*)
+{
+	constexpr int size{ PixelLanes::size };
+
+	//Only ever called through m_PixelShaders, with the material that handed it out
+	const MaterialShading& shading{ static_cast<const MaterialShading&>(material) };
+
+	const SamplerFilter filter{ shading.GetSamplerFilter() };
+
+	//Mip selection once per quad (the derivatives are coarse), shared by every map: they have the size of the diffuse map
+	MipSelection mips[PixelLanes::numQuads]{};
+	if constexpr (isNormalMap || shadingMode != ShadingMode::ObservedArea)
+	{
+		for (int quad{}; quad < PixelLanes::numQuads; ++quad)
+		{
+			const int lane{ quad * PixelLanes::quadSize };
+			if (((pixelMask >> lane) & ((1 << PixelLanes::quadSize) - 1)) == 0) continue;
+
+			const Vector2 ddx{ PixelLanes::Ddx(lanes.uvX, lane), PixelLanes::Ddx(lanes.uvY, lane) };
+			const Vector2 ddy{ PixelLanes::Ddy(lanes.uvX, lane), PixelLanes::Ddy(lanes.uvY, lane) };
+			mips[quad] = shading.m_pDiffuseTexture->SelectMip(ddx, ddy, filter);
+		}
+	}
+
+	//Pre defined variables
+	Vector3 lightDirection{ .577f, -.577f, .577f };
+	float lightIntensity{ 7.f };
+	float shininess{ 25.f };
+	ColorRGB ambientColor{ 0.025f, 0.025f, 0.025f };
+
+	//1. Normal and tangent back to unit length (every lane, the math below runs on all of them at once)
+	alignas(32) float normalX[size];
+	alignas(32) float normalY[size];
+	alignas(32) float normalZ[size];
+	alignas(32) float tangentX[size];
+	alignas(32) float tangentY[size];
+	alignas(32) float tangentZ[size];
+	NormalizeLanes(lanes.normalX, lanes.normalY, lanes.normalZ, normalX, normalY, normalZ);
+	NormalizeLanes(lanes.tangentX, lanes.tangentY, lanes.tangentZ, tangentX, tangentY, tangentZ);
+
+	//2. Normal map, from tangent space (textures are only sampled for the lanes in the mask)
+	if constexpr (isNormalMap)
+	{
+		alignas(32) float sampleX[size]{};
+		alignas(32) float sampleY[size]{};
+		alignas(32) float sampleZ[size]{};
+		for (int lane{}, mask{ pixelMask }; mask != 0; ++lane, mask >>= 1)
+		{
+			if ((mask & 1) == 0) continue;
+
+			const Vector2 uv{ lanes.uvX[lane], lanes.uvY[lane] };
+			const ColorRGB sampledColor{ shading.m_pNormalTexture->Sample<m_AddressMode>(uv, mips[lane / PixelLanes::quadSize]) };
+			sampleX[lane] = 2.f * sampledColor.r - 1.f;
+			sampleY[lane] = 2.f * sampledColor.g - 1.f;
+			sampleZ[lane] = 2.f * sampledColor.b - 1.f;
+		}
+
+		for (int lane{}; lane < size; ++lane)
+		{
+			const float binormalX{ normalY[lane] * tangentZ[lane] - normalZ[lane] * tangentY[lane] };
+			const float binormalY{ normalZ[lane] * tangentX[lane] - normalX[lane] * tangentZ[lane] };
+			const float binormalZ{ normalX[lane] * tangentY[lane] - normalY[lane] * tangentX[lane] };
+
+			const float x{ tangentX[lane] * sampleX[lane] + binormalX * sampleY[lane] + normalX[lane] * sampleZ[lane] };
+			const float y{ tangentY[lane] * sampleX[lane] + binormalY * sampleY[lane] + normalY[lane] * sampleZ[lane] };
+			const float z{ tangentZ[lane] * sampleX[lane] + binormalZ * sampleY[lane] + normalZ[lane] * sampleZ[lane] };
+
+			normalX[lane] = x;
+			normalY[lane] = y;
+			normalZ[lane] = z;
+		}
+	}
+
+	//3. Observed area (lambert cosine law)
+	alignas(32) float observedArea[size];
+	for (int lane{}; lane < size; ++lane)
+	{
+		observedArea[lane] = normalX[lane] * -lightDirection.x + normalY[lane] * -lightDirection.y + normalZ[lane] * -lightDirection.z;
+	}
+
+	//4. View direction, only the specular term needs it
+	alignas(32) float viewX[size];
+	alignas(32) float viewY[size];
+	alignas(32) float viewZ[size];
+	if constexpr (shadingMode == ShadingMode::Specular || shadingMode == ShadingMode::Combined)
+	{
+		const Vector3 cameraPosition{ shading.m_InvViewMat[3].GetXYZ() };
+		for (int lane{}; lane < size; ++lane)
+		{
+			viewX[lane] = lanes.worldX[lane] - cameraPosition.x;
+			viewY[lane] = lanes.worldY[lane] - cameraPosition.y;
+			viewZ[lane] = lanes.worldZ[lane] - cameraPosition.z;
+		}
+		NormalizeLanes(viewX, viewY, viewZ, viewX, viewY, viewZ);
+	}
+
+	//5. Texture lookups and BRDFs of the lanes in the mask
+	for (int lane{}, mask{ pixelMask }; mask != 0; ++lane, mask >>= 1)
+	{
+		if ((mask & 1) == 0) continue;
+
+		ColorRGB finalColor{ ambientColor };
+		const float dotProduct{ observedArea[lane] };
+		if (dotProduct >= 0.f)
+		{
+			const Vector2 uv{ lanes.uvX[lane], lanes.uvY[lane] };
+			const MipSelection& mip{ mips[lane / PixelLanes::quadSize] };
+
+			if constexpr (shadingMode == ShadingMode::ObservedArea)
+			{
+				finalColor += { dotProduct, dotProduct, dotProduct };
+			}
+
+			if constexpr (shadingMode == ShadingMode::Diffuse || shadingMode == ShadingMode::Combined)
+			{
+				finalColor += BRDF::Lambert(lightIntensity, shading.m_pDiffuseTexture->Sample<m_AddressMode>(uv, mip)) * dotProduct;
+			}
+
+			if constexpr (shadingMode == ShadingMode::Specular || shadingMode == ShadingMode::Combined)
+			{
+				const Vector3 normal{ normalX[lane], normalY[lane], normalZ[lane] };
+				const Vector3 viewDirection{ viewX[lane], viewY[lane], viewZ[lane] };
+				finalColor += BRDF::Phong(shading.m_pSpecularTexture->Sample<m_AddressMode>(uv, mip), shininess * shading.m_pGlossTexture->Sample<m_AddressMode>(uv, mip).r, -lightDirection, viewDirection, normal) * dotProduct;
+			}
+		}
+
+		pColors[lane] = finalColor;
+	}
+
+	//Opaque, nothing gets discarded
+	return pixelMask;
+}
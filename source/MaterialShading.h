@@ -11,7 +11,10 @@ namespace dae
 	{
 	public:
 		// Constructors and Destructor
+		explicit MaterialShading();
+#if !defined(HEADLESS)
 		explicit MaterialShading(ID3D11Device* pDevice, const std::wstring& assetFile);
+#endif
 		~MaterialShading();
 		
 		// Copy and Move semantics
@@ -27,8 +30,8 @@ namespace dae
 		virtual void SetTexture(Texture* pTexture, const std::string& name) override;
 
 		//SOFTWARE
-		virtual void VertexShading(const std::vector<Vertex>& vertices_in, std::vector<Vertex_Out>& vertices_out) override;
-		virtual ColorRGB PixelShading(const Vertex_Out& v) override;
+		virtual int PixelShading(const PixelLanes& lanes, int pixelMask, ColorRGB* pColors, float* pAlphas) const override;
+		virtual PixelShader GetPixelShader() const override;
 
 		std::string CycleShading();
 		bool ToggleNormalMap();
@@ -51,6 +54,7 @@ namespace dae
 		Texture* m_pNormalTexture{};
 		Texture* m_pSpecularTexture{};
 		Texture* m_pGlossTexture{};
+		static constexpr AddressMode m_AddressMode{ AddressMode::Wrap }; //AddressU/V of the samplers in Vehicle.fx
 
 		enum class ShadingMode
 		{
@@ -67,6 +71,13 @@ namespace dae
 		//---------------------------
 		// Private Member Functions
 		//---------------------------		
+		virtual void ShadeAttributes(const std::vector<Vertex>& vertices_in, const VertexStreams& vertices_out, uint32_t first, uint32_t last) const override;
+
+		//One pixel shader per shading mode and normal map setting, F5/F6 only pick another entry
+		template<ShadingMode shadingMode, bool isNormalMap>
+		static int ShadePixels(const Material& material, const PixelLanes& lanes, int pixelMask, ColorRGB* pColors, float* pAlphas);
+		static const PixelShader::Function m_PixelShaders[static_cast<int>(ShadingMode::END)][2]; //[ShadingMode][isNormalMap]
+
 		void SetWorldMatrix(Matrix& matrix);
 		void SetInverseViewMatrix(Matrix& matrix);
 
@@ -11,6 +11,12 @@ using namespace dae;
 //-----------------------------------------------------------------
 // Constructors
 //-----------------------------------------------------------------
+MaterialTransparency::MaterialTransparency()
+	: Material()
+{
+}
+
+#if !defined(HEADLESS)
 MaterialTransparency::MaterialTransparency(ID3D11Device* pDevice, const std::wstring& assetFile)
 	: Material(pDevice, assetFile)
 {
@@ -19,6 +25,7 @@ MaterialTransparency::MaterialTransparency(ID3D11Device* pDevice, const std::wst
 	if (!m_pDiffuseMapVariable->IsValid())
 		std::wcout << L"Shader Resource gDiffuseMap Variable not valid\n";
 }
+#endif
 
 
 //-----------------------------------------------------------------
@@ -28,7 +35,9 @@ MaterialTransparency::~MaterialTransparency()
 {
 	delete m_pDiffuseTexture;
 
+#if !defined(HEADLESS)
 	if (m_pDiffuseMapVariable) m_pDiffuseMapVariable->Release();
+#endif
 }
 
 
@@ -43,14 +52,42 @@ void MaterialTransparency::SetTexture(Texture* pTexture, const std::string& name
 	{
 		if (pTexture == nullptr)
 			std::wcout << L"SetDiffuse failed: nullptr given\n";
-		else if (m_pDiffuseMapVariable)
+		else
 		{
 			m_pDiffuseTexture = pTexture;
-			m_pDiffuseMapVariable->SetResource(pTexture->GetResourceView());
+
+#if !defined(HEADLESS)
+			if (m_pDiffuseMapVariable)
+				m_pDiffuseMapVariable->SetResource(pTexture->GetResourceView());
+#endif
 		}
 	}
 }
 
+int MaterialTransparency::PixelShading(const PixelLanes& lanes, int pixelMask, ColorRGB* pColors, float* pAlphas) const
+{
+	//Unlit, the diffuse texture only (with its alpha), fully transparent texels are discarded so they never get blended
+	int keptMask{ pixelMask };
+	MipSelection mip{};
+	for (int lane{}, mask{ pixelMask }; mask != 0; ++lane, mask >>= 1)
+	{
+		//Mip selection once per quad, the derivatives are coarse
+		if (lane % PixelLanes::quadSize == 0 && (mask & ((1 << PixelLanes::quadSize) - 1)) != 0)
+		{
+			const Vector2 ddx{ PixelLanes::Ddx(lanes.uvX, lane), PixelLanes::Ddx(lanes.uvY, lane) };
+			const Vector2 ddy{ PixelLanes::Ddy(lanes.uvX, lane), PixelLanes::Ddy(lanes.uvY, lane) };
+			mip = m_pDiffuseTexture->SelectMip(ddx, ddy, m_SamplerFilter);
+		}
+		if ((mask & 1) == 0) continue;
+
+		const Vector2 uv{ lanes.uvX[lane], lanes.uvY[lane] };
+		pColors[lane] = m_pDiffuseTexture->Sample<m_AddressMode>(uv, mip, pAlphas[lane]);
+		if (pAlphas[lane] <= 0.f) keptMask &= ~(1 << lane);
+	}
+
+	return keptMask;
+}
+
 
 //-----------------------------------------------------------------
 // Private Member Functions
@@ -11,7 +11,10 @@ namespace dae
 	{
 	public:
 		// Constructors and Destructor
+		explicit MaterialTransparency();
+#if !defined(HEADLESS)
 		explicit MaterialTransparency(ID3D11Device* pDevice, const std::wstring& assetFile);
+#endif
 		~MaterialTransparency();
 		
 		// Copy and Move semantics
@@ -24,6 +27,9 @@ namespace dae
 		// Public Member Functions
 		//---------------------------
 		virtual void SetTexture(Texture* pTexture, const std::string& name) override;
+
+		//SOFTWARE
+		virtual int PixelShading(const PixelLanes& lanes, int pixelMask, ColorRGB* pColors, float* pAlphas) const override;
 	
 	
 	private:
@@ -31,6 +37,7 @@ namespace dae
 		ID3DX11EffectShaderResourceVariable* m_pDiffuseMapVariable{};
 
 		Texture* m_pDiffuseTexture{};
+		static constexpr AddressMode m_AddressMode{ AddressMode::Wrap }; //AddressU/V of the samplers in Fire.fx
 	
 		//---------------------------
 		// Private Member Functions
@@ -5,8 +5,117 @@
 #include <cassert>
 
 #include "MathHelpers.h"
+#include "SIMD.h"
 #include <cmath>
 
+namespace
+{
+	using namespace dae;
+
+	//out[c] = x * m[0][c] + y * m[1][c] + z * m[2][c] (+ m[3][c] for points), for every component c that has an output
+	//Scalar and SSE2 round every step like TransformPoint/TransformVector and match them bit for bit
+	//AVX2 rounds once per multiply-add (FMA): last bit differences, so frames rendered with -simd avx2 differ in a few pixels
+	struct TransformBatch
+	{
+		float m[4][4]{};
+		float* pOutput[4]{};
+		const std::byte* pInput{};
+		size_t stride{};
+		bool isPoint{};
+
+		const Vector3& GetInput(size_t index) const { return *reinterpret_cast<const Vector3*>(pInput + index * stride); }
+	};
+
+	void TransformScalar(const TransformBatch& batch, size_t first, size_t end)
+	{
+		for (size_t i{ first }; i < end; ++i)
+		{
+			const Vector3& v{ batch.GetInput(i) };
+			for (int c{}; c < 4; ++c)
+			{
+				if (!batch.pOutput[c]) continue;
+
+				float result{ v.x * batch.m[0][c] + v.y * batch.m[1][c] + v.z * batch.m[2][c] };
+				if (batch.isPoint) result += batch.m[3][c];
+				batch.pOutput[c][i] = result;
+			}
+		}
+	}
+
+#if defined(DAE_SIMD_X64)
+	//Returns the number of elements done, the rest is left for a narrower width
+	size_t TransformSSE2(const TransformBatch& batch, size_t first, size_t end)
+	{
+		constexpr size_t laneCount{ 4 };
+
+		size_t i{ first };
+		for (; i + laneCount <= end; i += laneCount)
+		{
+			//1. Gather the lanes (the inputs are strided, there is no wide load for them)
+			const Vector3& v0{ batch.GetInput(i) };
+			const Vector3& v1{ batch.GetInput(i + 1) };
+			const Vector3& v2{ batch.GetInput(i + 2) };
+			const Vector3& v3{ batch.GetInput(i + 3) };
+			const __m128 x{ _mm_setr_ps(v0.x, v1.x, v2.x, v3.x) };
+			const __m128 y{ _mm_setr_ps(v0.y, v1.y, v2.y, v3.y) };
+			const __m128 z{ _mm_setr_ps(v0.z, v1.z, v2.z, v3.z) };
+
+			//2. One component of 4 elements per step
+			for (int c{}; c < 4; ++c)
+			{
+				if (!batch.pOutput[c]) continue;
+
+				__m128 result{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(batch.m[0][c])), _mm_mul_ps(y, _mm_set1_ps(batch.m[1][c]))), _mm_mul_ps(z, _mm_set1_ps(batch.m[2][c]))) };
+				if (batch.isPoint) result = _mm_add_ps(result, _mm_set1_ps(batch.m[3][c]));
+				_mm_storeu_ps(batch.pOutput[c] + i, result);
+			}
+		}
+
+		return i;
+	}
+
+	DAE_TARGET_AVX2 size_t TransformAVX2(const TransformBatch& batch, size_t first, size_t end)
+	{
+		constexpr size_t laneCount{ 8 };
+
+		const __m256i laneOffsets{ _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(batch.stride))) };
+
+		size_t i{ first };
+		for (; i + laneCount <= end; i += laneCount)
+		{
+			//1. Gather the lanes
+			const float* pFirst{ &batch.GetInput(i).x };
+			const __m256 x{ _mm256_i32gather_ps(pFirst, laneOffsets, 1) };
+			const __m256 y{ _mm256_i32gather_ps(pFirst + 1, laneOffsets, 1) };
+			const __m256 z{ _mm256_i32gather_ps(pFirst + 2, laneOffsets, 1) };
+
+			//2. One component of 8 elements per step
+			for (int c{}; c < 4; ++c)
+			{
+				if (!batch.pOutput[c]) continue;
+
+				const __m256 offset{ batch.isPoint ? _mm256_set1_ps(batch.m[3][c]) : _mm256_setzero_ps() };
+				const __m256 result{ _mm256_fmadd_ps(z, _mm256_set1_ps(batch.m[2][c]), _mm256_fmadd_ps(y, _mm256_set1_ps(batch.m[1][c]), _mm256_fmadd_ps(x, _mm256_set1_ps(batch.m[0][c]), offset))) };
+				_mm256_storeu_ps(batch.pOutput[c] + i, result);
+			}
+		}
+
+		return i;
+	}
+#endif
+
+	void Transform(const TransformBatch& batch, size_t count)
+	{
+		//Widest width the cpu supports, the remainder falls through to the narrower ones
+		size_t done{};
+#if defined(DAE_SIMD_X64)
+		if (SIMD::GetLevel() >= SIMDLevel::avx2) done = TransformAVX2(batch, done, count);
+		if (SIMD::GetLevel() >= SIMDLevel::sse2) done = TransformSSE2(batch, done, count);
+#endif
+		TransformScalar(batch, done, count);
+	}
+}
+
 namespace dae {
 	Matrix::Matrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t) :
 		Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
@@ -72,6 +181,49 @@ namespace dae {
 		};
 	}
 
+	void Matrix::TransformPoints(const Vector3* pPoints, size_t stride, size_t count, float* pOutX, float* pOutY, float* pOutZ, float* pOutW) const
+	{
+		TransformBatch batch{};
+		for (int r{ 0 }; r < 4; ++r)
+		{
+			for (int c{ 0 }; c < 4; ++c)
+			{
+				batch.m[r][c] = data[r][c];
+			}
+		}
+
+		batch.pOutput[0] = pOutX;
+		batch.pOutput[1] = pOutY;
+		batch.pOutput[2] = pOutZ;
+		batch.pOutput[3] = pOutW;
+		batch.pInput = reinterpret_cast<const std::byte*>(pPoints);
+		batch.stride = stride;
+		batch.isPoint = true;
+
+		Transform(batch, count);
+	}
+
+	void Matrix::TransformVectors(const Vector3* pVectors, size_t stride, size_t count, float* pOutX, float* pOutY, float* pOutZ) const
+	{
+		TransformBatch batch{};
+		for (int r{ 0 }; r < 4; ++r)
+		{
+			for (int c{ 0 }; c < 4; ++c)
+			{
+				batch.m[r][c] = data[r][c];
+			}
+		}
+
+		batch.pOutput[0] = pOutX;
+		batch.pOutput[1] = pOutY;
+		batch.pOutput[2] = pOutZ;
+		batch.pInput = reinterpret_cast<const std::byte*>(pVectors);
+		batch.stride = stride;
+		batch.isPoint = false;
+
+		Transform(batch, count);
+	}
+
 	const Matrix& Matrix::Transpose()
 	{
 		Matrix result{};
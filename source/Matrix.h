@@ -28,6 +28,11 @@ namespace dae {
 		Vector4 TransformPoint(const Vector4& p) const;
 		Vector4 TransformPoint(float x, float y, float z, float w) const;
 
+		//Batches: count points/vectors that lie stride bytes apart (e.g. a member of a vertex array),
+		//written as structure of arrays, one output array per component. pOutW may be null
+		void TransformPoints(const Vector3* pPoints, size_t stride, size_t count, float* pOutX, float* pOutY, float* pOutZ, float* pOutW = nullptr) const;
+		void TransformVectors(const Vector3* pVectors, size_t stride, size_t count, float* pOutX, float* pOutY, float* pOutZ) const;
+
 		const Matrix& Transpose();
 		const Matrix& Inverse();
 
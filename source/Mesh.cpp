@@ -6,23 +6,106 @@
 #include "Utils.h"
 #include "Material.h"
 #include "Texture.h"
+#include "ThreadPool.h"
+#include <bit>
+#include <thread>
 
 using namespace dae;
 
 
+namespace
+{
+	//The SIMD kernels step the edge functions inside a step of quads (stepWidth x 2 pixels) in 32-bit lanes:
+	//the step start is clamped to +-2^30, which keeps its sign, and the lane offsets have to stay below 2^30
+	bool HasLaneSafeSteps(const TriangleSetup& triangle, int stepWidth)
+	{
+		constexpr int64_t laneLimit{ int64_t(1) << 30 };
+
+		for (int i{}; i < 3; ++i)
+		{
+			if ((stepWidth - 1) * std::abs(triangle.edgeStepX[i]) + std::abs(triangle.edgeStepY[i]) >= laneLimit) return false;
+		}
+
+		return true;
+	}
+
+	int32_t ClampToLane(int64_t edgeValue)
+	{
+		constexpr int64_t laneLimit{ int64_t(1) << 30 };
+		return static_cast<int32_t>(std::clamp(edgeValue, -laneLimit, laneLimit));
+	}
+
+#if defined(DAE_SIMD_X64)
+	//Plane at the pixels of a step of quads, in the order of AttributePlane::Evaluate so SSE2 and scalar frames match bit for bit
+	__m128 Evaluate4(const AttributePlane& plane, __m128 pixelX, __m128 pixelY)
+	{
+		const __m128 column{ _mm_add_ps(_mm_set1_ps(plane.origin), _mm_mul_ps(pixelX, _mm_set1_ps(plane.dx))) };
+		return _mm_add_ps(column, _mm_mul_ps(pixelY, _mm_set1_ps(plane.dy)));
+	}
+
+	DAE_TARGET_AVX2 __m256 Evaluate8(const AttributePlane& plane, __m256 pixelX, __m256 pixelY)
+	{
+		const __m256 row{ _mm256_fmadd_ps(pixelY, _mm256_set1_ps(plane.dy), _mm256_set1_ps(plane.origin)) };
+		return _mm256_fmadd_ps(pixelX, _mm256_set1_ps(plane.dx), row);
+	}
+
+	//Buffer rows <-> quad lanes (lane = dy * 2 + dx)
+	__m128 LoadQuad(const float* pRow0, const float* pRow1)
+	{
+		const __m128 top{ _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(pRow0)) };
+		return _mm_loadh_pi(top, reinterpret_cast<const __m64*>(pRow1));
+	}
+
+	void StoreQuad(float* pRow0, float* pRow1, __m128 quad)
+	{
+		_mm_storel_pi(reinterpret_cast<__m64*>(pRow0), quad);
+		_mm_storeh_pi(reinterpret_cast<__m64*>(pRow1), quad);
+	}
+
+	//Buffer rows <-> two quads side by side (lane = quad * 4 + dy * 2 + dx), swapping the middle pixel pairs
+	DAE_TARGET_AVX2 __m256 LoadQuads(const float* pRow0, const float* pRow1)
+	{
+		const __m128d top{ _mm_castps_pd(_mm_loadu_ps(pRow0)) };
+		const __m128d bottom{ _mm_castps_pd(_mm_loadu_ps(pRow1)) };
+		return _mm256_set_m128(_mm_castpd_ps(_mm_unpackhi_pd(top, bottom)), _mm_castpd_ps(_mm_unpacklo_pd(top, bottom)));
+	}
+
+	DAE_TARGET_AVX2 void StoreQuads(float* pRow0, float* pRow1, __m256 quads)
+	{
+		const __m128d left{ _mm_castps_pd(_mm256_castps256_ps128(quads)) };
+		const __m128d right{ _mm_castps_pd(_mm256_extractf128_ps(quads, 1)) };
+		_mm_storeu_ps(pRow0, _mm_castpd_ps(_mm_unpacklo_pd(left, right)));
+		_mm_storeu_ps(pRow1, _mm_castpd_ps(_mm_unpackhi_pd(left, right)));
+	}
+#endif
+}
+
+
 //-----------------------------------------------------------------
 // Constructors
 //-----------------------------------------------------------------
-Mesh::Mesh(ID3D11Device* pDevice, SDL_Surface* pBackBuffer, const std::string& filename, Material* pMaterial)
+Mesh::Mesh(const std::string& filename, Material* pMaterial)
 	: m_pMaterial(pMaterial)
 {
-	//Create Software Buffers
-	m_pBackBufferPixels = (uint32_t*)pBackBuffer->pixels;
-	m_pDepthBufferPixels = new float[pBackBuffer->w * pBackBuffer->h];
-
 	//Get Vertices and Indices
 	Utils::ParseOBJ(filename, m_Vertices, m_Indices);
 
+	//Face Normals, for back-face culling before vertex shading
+	m_FaceNormals.reserve(m_Indices.size() / 3);
+	for (size_t i{}; i + 2 < m_Indices.size(); i += 3)
+	{
+		const Vector3& p0{ m_Vertices[m_Indices[i]].position };
+		const Vector3& p1{ m_Vertices[m_Indices[i + 1]].position };
+		const Vector3& p2{ m_Vertices[m_Indices[i + 2]].position };
+
+		m_FaceNormals.emplace_back(Vector3::Cross(p1 - p0, p2 - p0));
+	}
+}
+
+#if !defined(HEADLESS)
+Mesh::Mesh(ID3D11Device* pDevice, const std::string& filename, Material* pMaterial)
+	: Mesh(filename, pMaterial)
+{
 	//Create Vertex Buffer
 	D3D11_BUFFER_DESC bd = {};
 	bd.Usage = D3D11_USAGE_IMMUTABLE;
@@ -52,6 +135,7 @@ Mesh::Mesh(ID3D11Device* pDevice, SDL_Surface* pBackBuffer, const std::string& f
 	if (FAILED(result))
 		return;
 }
+#endif
 
 
 //-----------------------------------------------------------------
@@ -59,10 +143,10 @@ Mesh::Mesh(ID3D11Device* pDevice, SDL_Surface* pBackBuffer, const std::string& f
 //-----------------------------------------------------------------
 Mesh::~Mesh()
 {
-	delete[] m_pDepthBufferPixels;
-
-	m_pIndexBuffer->Release();
-	m_pVertexBuffer->Release();
+#if !defined(HEADLESS)
+	if (m_pIndexBuffer) m_pIndexBuffer->Release();
+	if (m_pVertexBuffer) m_pVertexBuffer->Release();
+#endif
 
 	delete m_pMaterial;
 }
@@ -71,6 +155,7 @@ Mesh::~Mesh()
 //-----------------------------------------------------------------
 // Public Member Functions
 //-----------------------------------------------------------------
+#if !defined(HEADLESS)
 void Mesh::RenderHardware(ID3D11DeviceContext* pDeviceContext) const
 {
 	//1. Set Primitive Topology
@@ -96,27 +181,225 @@ void Mesh::RenderHardware(ID3D11DeviceContext* pDeviceContext) const
 		pDeviceContext->DrawIndexed(m_NumIndices, 0, 0);
 	}
 }
+#endif
 
-void Mesh::RenderSoftware(SDL_Surface* pBackBuffer) const
+void Mesh::RenderSoftware(const FrameBuffer& frameBuffer, ThreadPool& threadPool, FrameArena& frameArena, const Vector3& cameraPosition)
 {
-	//1. Reset Detph Buffer
-	std::fill_n(m_pDepthBufferPixels, pBackBuffer->w * pBackBuffer->h, FLT_MAX);
+	//1. Depth Buffer is shared with the other meshes, the renderer clears it once per frame
+	//Every transient buffer below lives in the frame arena, steady state frames never touch the heap
+	m_Stats = PipelineStats{};
+
+	//Transparent meshes leave no depth behind, the depth view has nothing to show of them
+	if (m_IsTransparent && m_IsShowDepthBuffer)
+		return;
+
+	//2. Back-face Culling (object space), before any vertex gets shaded
+	CullTriangles(cameraPosition);
+
+	//3. Vertex Shading (only the vertices of the remaining triangles), into one stream per component
+	//Lazy: only the positions, the other attributes follow during setup for the vertices of triangles that survive culling
+	VertexStreams verticesOut{};
+	verticesOut.Assign(frameArena.Allocate<float>(VertexStreams::numStreams * m_Vertices.size()), m_Vertices.size());
+
+	const uint32_t numVertices{ static_cast<uint32_t>(m_Vertices.size()) };
+	const uint32_t numVertexGroups{ (numVertices + m_VertexGroupSize - 1) / m_VertexGroupSize };
+
+	VertexState* pVertexStates{}; //[vertex / m_VertexGroupSize]
+	if (m_IsLazyVertexShading)
+	{
+		pVertexStates = frameArena.Allocate<VertexState>(numVertexGroups);
+		std::fill_n(pVertexStates, numVertexGroups, VertexState::Unshaded);
+		m_pMaterial->VertexPositionShading(m_Vertices, verticesOut, m_IsVertexUsed, threadPool);
+	}
+	else
+	{
+		m_pMaterial->VertexShading(m_Vertices, verticesOut, m_IsVertexUsed, threadPool);
+	}
+
+	//4. Transparency: back to front, binning keeps the order so every pixel gets blended over what lies behind it
+	//Weighted blended transparency does not depend on the order
+	if (m_IsTransparent && !m_IsWeightedBlended)
+		SortBackToFront(verticesOut, frameArena);
+
+	//5. Triangle Setup + Binning
+	//Every chunk of triangles bins into its own lists, so no locking is needed and submission order is kept
+	const int numTilesX{ (frameBuffer.width + m_TileSize - 1) / m_TileSize };
+	const int numTilesY{ (frameBuffer.height + m_TileSize - 1) / m_TileSize };
+	const uint32_t numTiles{ static_cast<uint32_t>(numTilesX * numTilesY) };
+
+	const uint32_t numTriangles{ static_cast<uint32_t>(m_VisibleTriangles.size()) };
+	m_Stats.numTriangles = static_cast<uint32_t>(m_Indices.size() / 3);
+	m_Stats.numCulled = m_Stats.numTriangles - numTriangles;
+
+	const uint32_t numChunks{ std::min(numTriangles, threadPool.GetNumThreads() * m_ChunksPerThread) };
+	if (numChunks == 0)
+		return;
+
+	const uint32_t trianglesPerChunk{ (numTriangles + numChunks - 1) / numChunks };
+
+	FrameVector<TriangleSetup>* pTriangles{ frameArena.Allocate<FrameVector<TriangleSetup>>(numChunks) }; //[chunk], set up (and clipped) triangles in submission order
+	FrameVector<uint32_t>* pBins{ frameArena.Allocate<FrameVector<uint32_t>>(static_cast<size_t>(numChunks) * numTiles) }; //[chunk * numTiles + tile], triangles in submission order
+
+	threadPool.ParallelFor(numChunks, [&](uint32_t chunk)
+		{
+			const uint32_t first{ chunk * trianglesPerChunk };
+			const uint32_t last{ std::min(first + trianglesPerChunk, numTriangles) };
+
+			//Most triangles come out of clipping as exactly one
+			FrameVector<TriangleSetup>& triangles{ pTriangles[chunk] };
+			FrameVector<uint32_t>* pChunkBins{ pBins + static_cast<size_t>(chunk) * numTiles };
+
+			triangles = FrameVector<TriangleSetup>{ &frameArena, last > first ? last - first : 0 };
+			for (uint32_t tile{}; tile < numTiles; ++tile)
+			{
+				pChunkBins[tile] = FrameVector<uint32_t>{ &frameArena, 0 };
+			}
+
+			for (uint32_t i{ first }; i < last; ++i)
+			{
+				//Clipping can turn one triangle into several (or none)
+				const uint32_t t{ m_VisibleTriangles[i] };
+				const uint32_t firstSetup{ triangles.size() };
+				AssembleTriangle(frameBuffer, verticesOut, pVertexStates, m_Indices[t * 3], m_Indices[t * 3 + 1], m_Indices[t * 3 + 2], triangles);
 
-	//2. Vertex Shading
-	std::vector<Vertex_Out> verticesOut;
-	m_pMaterial->VertexShading(m_Vertices, verticesOut);
+				for (uint32_t setup{ firstSetup }; setup < triangles.size(); ++setup)
+				{
+					//Add the triangle to every tile its bounding box overlaps
+					const TriangleSetup& triangle{ triangles[setup] };
+					const int tileLeft{ triangle.min.x / m_TileSize };
+					const int tileTop{ triangle.min.y / m_TileSize };
+					const int tileRight{ (triangle.max.x - 1) / m_TileSize };
+					const int tileBottom{ (triangle.max.y - 1) / m_TileSize };
+
+					for (int ty{ tileTop }; ty <= tileBottom; ++ty)
+					{
+						for (int tx{ tileLeft }; tx <= tileRight; ++tx)
+						{
+							pChunkBins[tx + (ty * numTilesX)].push_back(setup);
+						}
+					}
+				}
+			}
+		});
+
+	uint32_t numSetUp{};
+	for (uint32_t chunk{}; chunk < numChunks; ++chunk)
+	{
+		numSetUp += pTriangles[chunk].size();
+	}
+
+	m_Stats.numVertices = numVertices;
+	if (m_IsLazyVertexShading)
+	{
+		for (uint32_t group{}; group < numVertexGroups; ++group)
+		{
+			if (pVertexStates[group] == VertexState::Shaded)
+				m_Stats.numShadedVertices += std::min(m_VertexGroupSize, numVertices - group * m_VertexGroupSize);
+		}
+	}
+	else
+	{
+		m_Stats.numShadedVertices = static_cast<uint32_t>(std::count(m_IsVertexUsed.begin(), m_IsVertexUsed.end(), uint8_t{ 1 }));
+	}
+
+	//6. Triangle IDs for the visibility buffer
+	//Transparent meshes always shade forward, a visibility buffer only keeps the nearest triangle
+	const bool isDeferred{ m_IsDeferred && !m_IsTransparent };
+	const TriangleSetup** pTriangleTable{};
+	if (isDeferred)
+	{
+		pTriangleTable = frameArena.Allocate<const TriangleSetup*>(numSetUp);
+
+		uint32_t id{};
+		for (uint32_t chunk{}; chunk < numChunks; ++chunk)
+		{
+			for (TriangleSetup& triangle : pTriangles[chunk])
+			{
+				triangle.id = id;
+				pTriangleTable[id++] = &triangle;
+			}
+		}
+	}
+
+	//7. Render Tiles (deferred: depth + visibility only), with the kernel and pixel shader specialized for the current state
+	const RenderTriangleFunction pRenderTriangle{ SelectRenderTriangle() };
+	m_PixelShader = m_pMaterial->GetPixelShader();
+
+	PipelineStats* pTileStats{ frameArena.Allocate<PipelineStats>(numTiles) }; //[tile], every tile counts on its own thread
+	std::fill_n(pTileStats, numTiles, PipelineStats{});
+
+	threadPool.ParallelFor(numTiles, [&](uint32_t tile)
+		{
+			const Int2 tileMin{ static_cast<int>(tile % numTilesX) * m_TileSize, static_cast<int>(tile / numTilesX) * m_TileSize };
+			const Int2 tileMax{ std::min(tileMin.x + m_TileSize, frameBuffer.width), std::min(tileMin.y + m_TileSize, frameBuffer.height) };
+
+			for (uint32_t chunk{}; chunk < numChunks; ++chunk)
+			{
+				const FrameVector<TriangleSetup>& triangles{ pTriangles[chunk] };
+				for (uint32_t t : pBins[static_cast<size_t>(chunk) * numTiles + tile])
+				{
+					(this->*pRenderTriangle)(frameBuffer, triangles[t], tileMin, tileMax, pTileStats[tile]);
+				}
+			}
+		});
+
+	//8. Deferred Shading: every visible pixel gets shaded exactly once, pairs of rows (quads) are independent
+	if (isDeferred && !m_IsShowBoundingBox)
+	{
+		const auto pShadeVisibleQuads{ m_IsShowDepthBuffer ? &Mesh::ShadeVisibleQuads<PixelOutput::Depth> : &Mesh::ShadeVisibleQuads<PixelOutput::Color> };
+
+		threadPool.ParallelFor(static_cast<uint32_t>((frameBuffer.height + 1) / 2), [&](uint32_t quadRow)
+			{
+				(this->*pShadeVisibleQuads)(frameBuffer, pTriangleTable, static_cast<int>(quadRow) * 2);
+			});
+	}
 
-	//3. Render Triangles
-	for (int i{}; i < m_Indices.size() - 2; i += 3)
+	//9. Stats
+	m_Stats.numSetUp = numSetUp;
+	for (uint32_t tile{}; tile < numTiles; ++tile)
 	{
-		RenderTriangle(pBackBuffer,
-			verticesOut[m_Indices[i]],
-			verticesOut[m_Indices[i + 1]],
-			verticesOut[m_Indices[i + 2]]
-		);
+		m_Stats.numBinned += pTileStats[tile].numBinned;
+		m_Stats.numHiZTriangles += pTileStats[tile].numHiZTriangles;
+		m_Stats.numHiZBlocks += pTileStats[tile].numHiZBlocks;
 	}
 }
 
+void Mesh::ResolveWeightedBlended(const FrameBuffer& frameBuffer, ThreadPool& threadPool)
+{
+	threadPool.ParallelFor(static_cast<uint32_t>(frameBuffer.height), [&](uint32_t py)
+		{
+			const int first{ static_cast<int>(py) * frameBuffer.width };
+			for (int pixelIndex{ first }; pixelIndex < first + frameBuffer.width; ++pixelIndex)
+			{
+				//1. Untouched by every weighted blended draw (they discard what is fully transparent)
+				float* pAccumulation{ frameBuffer.pAccumulation + static_cast<size_t>(pixelIndex) * 4 };
+				if (pAccumulation[3] == 0.f) continue;
+
+				//2. Weighted average of the fragments, over what shows through all of them
+				const float revealage{ frameBuffer.pRevealage[pixelIndex] };
+				const float weightSum{ std::max(pAccumulation[3], 1e-5f) };
+				const ColorRGB average{ pAccumulation[0] / weightSum, pAccumulation[1] / weightSum, pAccumulation[2] / weightSum };
+
+				const uint32_t pixel{ frameBuffer.pPixels[pixelIndex] };
+				const ColorRGB destination{
+					((pixel >> frameBuffer.redShift) & 0xFF) / 255.f,
+					((pixel >> frameBuffer.greenShift) & 0xFF) / 255.f,
+					((pixel >> frameBuffer.blueShift) & 0xFF) / 255.f };
+
+				ColorRGB color{ average * (1.f - revealage) + destination * revealage };
+				color.MaxToOne();
+				frameBuffer.pPixels[pixelIndex] = frameBuffer.MapRGB(
+					static_cast<uint8_t>(color.r * 255),
+					static_cast<uint8_t>(color.g * 255),
+					static_cast<uint8_t>(color.b * 255));
+
+				//3. Ready for the next frame
+				std::fill_n(pAccumulation, 4, 0.f);
+				frameBuffer.pRevealage[pixelIndex] = 1.f;
+			}
+		});
+}
+
 bool Mesh::ToggleDepthBuffer()
 {
 	return m_IsShowDepthBuffer = !m_IsShowDepthBuffer;
@@ -127,6 +410,26 @@ bool Mesh::ToggleBoundingBox()
 	return m_IsShowBoundingBox = !m_IsShowBoundingBox;
 }
 
+bool Mesh::ToggleFixedPoint()
+{
+	return m_IsFixedPoint = !m_IsFixedPoint;
+}
+
+bool Mesh::ToggleDeferred()
+{
+	return m_IsDeferred = !m_IsDeferred;
+}
+
+bool Mesh::ToggleLazyVertexShading()
+{
+	return m_IsLazyVertexShading = !m_IsLazyVertexShading;
+}
+
+bool Mesh::ToggleWeightedBlended()
+{
+	return m_IsWeightedBlended = !m_IsWeightedBlended;
+}
+
 void Mesh::Translate(const Vector3& translation)
 {
 	m_Position += translation;
@@ -158,141 +461,1375 @@ void Mesh::SetScale(const Vector3& scale)
 }
 
 
+//-----------------------------------------------------------------
+// Static Member Variables
+//-----------------------------------------------------------------
+const Mesh::RenderTriangleFunction Mesh::m_RenderTriangleFunctions[static_cast<int>(PixelOutput::END)][static_cast<int>(PixelKernel::END)]
+{
+	{
+		&Mesh::RenderTriangle<PixelOutput::Color, PixelKernel::Float>,
+		&Mesh::RenderTriangle<PixelOutput::Color, PixelKernel::Fixed>,
+		&Mesh::RenderTriangle<PixelOutput::Color, PixelKernel::FixedSSE2>,
+		&Mesh::RenderTriangle<PixelOutput::Color, PixelKernel::FixedAVX2>,
+	},
+	{
+		&Mesh::RenderTriangle<PixelOutput::Depth, PixelKernel::Float>,
+		&Mesh::RenderTriangle<PixelOutput::Depth, PixelKernel::Fixed>,
+		&Mesh::RenderTriangle<PixelOutput::Depth, PixelKernel::FixedSSE2>,
+		&Mesh::RenderTriangle<PixelOutput::Depth, PixelKernel::FixedAVX2>,
+	},
+	{
+		&Mesh::RenderTriangle<PixelOutput::Visibility, PixelKernel::Float>,
+		&Mesh::RenderTriangle<PixelOutput::Visibility, PixelKernel::Fixed>,
+		&Mesh::RenderTriangle<PixelOutput::Visibility, PixelKernel::FixedSSE2>,
+		&Mesh::RenderTriangle<PixelOutput::Visibility, PixelKernel::FixedAVX2>,
+	},
+	{
+		&Mesh::RenderTriangle<PixelOutput::Blend, PixelKernel::Float>,
+		&Mesh::RenderTriangle<PixelOutput::Blend, PixelKernel::Fixed>,
+		&Mesh::RenderTriangle<PixelOutput::Blend, PixelKernel::FixedSSE2>,
+		&Mesh::RenderTriangle<PixelOutput::Blend, PixelKernel::FixedAVX2>,
+	},
+	{
+		&Mesh::RenderTriangle<PixelOutput::Accumulate, PixelKernel::Float>,
+		&Mesh::RenderTriangle<PixelOutput::Accumulate, PixelKernel::Fixed>,
+		&Mesh::RenderTriangle<PixelOutput::Accumulate, PixelKernel::FixedSSE2>,
+		&Mesh::RenderTriangle<PixelOutput::Accumulate, PixelKernel::FixedAVX2>,
+	},
+};
+
+
 //-----------------------------------------------------------------
 // Private Member Functions
 //-----------------------------------------------------------------
-void Mesh::RenderTriangle(SDL_Surface* pBackBuffer, const Vertex_Out& _v0, const Vertex_Out& _v1, const Vertex_Out& _v2) const
+void Mesh::CullTriangles(const Vector3& cameraPosition)
 {
 	// Variables
-	int width{ pBackBuffer->w };
-	int height{ pBackBuffer->h };
+	const uint32_t numTriangles{ static_cast<uint32_t>(m_Indices.size() / 3) };
 
-	//1. Frustum Culling
-	if (FrustumCulling(_v0.position) || FrustumCulling(_v1.position) || FrustumCulling(_v2.position)) return;
+	m_VisibleTriangles.clear();
+	m_IsVertexUsed.assign(m_Vertices.size(), 0);
 
-	//2. NDC to Raster Space
-	Vertex_Out v0{ NDCToRaster(_v0, width, height) };
-	Vertex_Out v1{ NDCToRaster(_v1, width, height) };
-	Vertex_Out v2{ NDCToRaster(_v2, width, height) };
+	//1. Camera to Object Space, so the face normals never have to be transformed
+	const Matrix world{ GetWorldMatrix() };
+	const Vector3 cameraObject{ Matrix::Inverse(world).TransformPoint(cameraPosition) };
 
-	Vector2 edge0 = v2.position.GetXY() - v1.position.GetXY();
-	Vector2 edge1 = v0.position.GetXY() - v2.position.GetXY();
-	Vector2 edge2 = v1.position.GetXY() - v0.position.GetXY();
+	//A mirroring world matrix flips the winding on screen
+	const bool isMirrored{ Vector3::Dot(Vector3::Cross(world.GetAxisX(), world.GetAxisY()), world.GetAxisZ()) < 0.f };
 
-	//3. Calculate Signed Area
-	float area{ Vector2::Cross(edge0, edge1) };
-	if (area < 0.001f) return;
+	//2. Keep the triangles facing the wanted way and flag their vertices for shading
+	for (uint32_t t{}; t < numTriangles; ++t)
+	{
+		if (m_CullMode != CullMode::None)
+		{
+			const Vector3& p0{ m_Vertices[m_Indices[t * 3]].position };
+			const bool isFront{ (Vector3::Dot(m_FaceNormals[t], cameraObject - p0) > 0.f) != isMirrored };
 
-	//4. Calculate Bounding Box
-	int left{ (int)std::min(v0.position.x, std::min(v1.position.x, v2.position.x)) };
-	int top{ (int)std::min(v0.position.y, std::min(v1.position.y, v2.position.y)) };
-	int right{ (int)ceilf(std::max(v0.position.x, std::max(v1.position.x, v2.position.x))) };
-	int bottom{ (int)ceilf(std::max(v0.position.y, std::max(v1.position.y, v2.position.y))) };
+			if (isFront == (m_CullMode == CullMode::Front)) continue;
+		}
 
-	if (left < 0) left = 0;
-	if (top < 0) top = 0;
-	if (right >= width) right = width - 1;
-	if (bottom >= height) bottom = height - 1;
+		m_VisibleTriangles.push_back(t);
+		m_IsVertexUsed[m_Indices[t * 3]] = 1;
+		m_IsVertexUsed[m_Indices[t * 3 + 1]] = 1;
+		m_IsVertexUsed[m_Indices[t * 3 + 2]] = 1;
+	}
+}
+
+void Mesh::SortBackToFront(const VertexStreams& vertices, FrameArena& frameArena)
+{
+	// Variables
+	const uint32_t numTriangles{ static_cast<uint32_t>(m_VisibleTriangles.size()) };
+	if (numTriangles < 2)
+		return;
+
+	uint32_t* pTriangles{ m_VisibleTriangles.data() };
+	uint32_t* pKeys{ frameArena.Allocate<uint32_t>(numTriangles) };
+	uint32_t* pTempTriangles{ frameArena.Allocate<uint32_t>(numTriangles) };
+	uint32_t* pTempKeys{ frameArena.Allocate<uint32_t>(numTriangles) };
+
+	//1. Key: view depth of the centroid (clip space w, summed instead of averaged) as bits that sort like the float, far first
+	for (uint32_t i{}; i < numTriangles; ++i)
+	{
+		const uint32_t t{ pTriangles[i] };
+		const float depth{ vertices.pPositionW[m_Indices[t * 3]] + vertices.pPositionW[m_Indices[t * 3 + 1]] + vertices.pPositionW[m_Indices[t * 3 + 2]] };
 
-	//5. Render Pixels
-	for (int px{ left }; px < right; ++px)
+		const uint32_t bits{ std::bit_cast<uint32_t>(depth) };
+		pKeys[i] = ~(bits ^ ((bits >> 31) != 0 ? 0xFFFFFFFFu : 0x80000000u));
+	}
+
+	//2. LSD radix sort, 8 bits per pass, stable so triangles at the same depth keep submission order
+	for (int shift{}; shift < 32; shift += 8)
 	{
-		for (int py{ top }; py < bottom; ++py)
+		uint32_t offsets[256]{};
+		for (uint32_t i{}; i < numTriangles; ++i)
 		{
-			if (m_IsShowBoundingBox)
-			{
-				m_pBackBufferPixels[px + (py * width)] = SDL_MapRGB(pBackBuffer->format,
-					static_cast<uint8_t>(255),
-					static_cast<uint8_t>(255),
-					static_cast<uint8_t>(255));
+			++offsets[(pKeys[i] >> shift) & 0xFF];
+		}
 
-				continue;
-			}
+		//Every key has the same digit, nothing moves
+		if (offsets[(pKeys[0] >> shift) & 0xFF] == numTriangles) continue;
+
+		for (uint32_t digit{}, sum{}; digit < 256; ++digit)
+		{
+			const uint32_t count{ offsets[digit] };
+			offsets[digit] = sum;
+			sum += count;
+		}
+
+		for (uint32_t i{}; i < numTriangles; ++i)
+		{
+			const uint32_t destination{ offsets[(pKeys[i] >> shift) & 0xFF]++ };
+			pTempKeys[destination] = pKeys[i];
+			pTempTriangles[destination] = pTriangles[i];
+		}
 
-			float w0, w1, w2;
-			Vector2 pixel{ (float)px, (float)py };
+		std::swap(pKeys, pTempKeys);
+		std::swap(pTriangles, pTempTriangles);
+	}
 
-			//Check if pixel is inside triangle
-			Vector2 pixelToSide = pixel - v0.position.GetXY();
-			if ((w2 = Vector2::Cross(edge2, pixelToSide) / area) < 0.f) continue;
+	if (pTriangles != m_VisibleTriangles.data())
+		std::copy_n(pTriangles, numTriangles, m_VisibleTriangles.data());
+}
 
-			pixelToSide = pixel - v1.position.GetXY();
-			if ((w0 = Vector2::Cross(edge0, pixelToSide) / area) < 0.f) continue;
+void Mesh::AssembleTriangle(const FrameBuffer& frameBuffer, const VertexStreams& vertices, VertexState* pVertexStates, uint32_t i0, uint32_t i1, uint32_t i2, FrameVector<TriangleSetup>& triangles) const
+{
+	//1. Frustum Culling (only triangles that are completely outside), the positions are enough for that
+	const Vector4 p0{ vertices.pPositionX[i0], vertices.pPositionY[i0], vertices.pPositionZ[i0], vertices.pPositionW[i0] };
+	const Vector4 p1{ vertices.pPositionX[i1], vertices.pPositionY[i1], vertices.pPositionZ[i1], vertices.pPositionW[i1] };
+	const Vector4 p2{ vertices.pPositionX[i2], vertices.pPositionY[i2], vertices.pPositionZ[i2], vertices.pPositionW[i2] };
+	if (FrustumCulling(p0, p1, p2)) return;
 
-			pixelToSide = pixel - v2.position.GetXY();
-			if ((w1 = Vector2::Cross(edge1, pixelToSide) / area) < 0.f) continue;
+	//2. Triangle Setup, most triangles are inside the guard band and in front of the near plane
+	//The cull mode and the edges only need the positions, the other attributes are fetched for triangles that pass
+	TriangleSetup triangle{};
+	if (!NeedsClipping(p0, p1, p2))
+	{
+		Vector4 positions[3]{ p0, p1, p2 };
+		uint32_t corners[3]{ i0, i1, i2 };
+		if (!SetupTriangle(frameBuffer, positions, corners, triangle)) return;
 
-			//Calculate depth buffer
-			float depthBuffer = 1.f / ((w0 / v0.position.z) + (w1 / v1.position.z) + (w2 / v2.position.z));
+		const Vertex_Out cornerVertices[3]
+		{
+			FetchVertex(vertices, pVertexStates, corners[0]),
+			FetchVertex(vertices, pVertexStates, corners[1]),
+			FetchVertex(vertices, pVertexStates, corners[2])
+		};
+		const Vertex_Out* pCornerVertices[3]{ &cornerVertices[0], &cornerVertices[1], &cornerVertices[2] };
 
-			if (depthBuffer < 0 || depthBuffer > 1) continue;
+		if (SetupAttributePlanes(pCornerVertices, positions, triangle))
+			triangles.push_back(triangle);
 
-			//Depth Test
-			if (depthBuffer < m_pDepthBufferPixels[px + (py * width)])
-			{
-				//Depth Write
-				m_pDepthBufferPixels[px + (py * width)] = depthBuffer;
+		return;
+	}
 
-				ColorRGB finalColor{};
-				if (m_IsShowDepthBuffer)
-				{
-					//Remap the depthbuffer to avoid having everything in white
-					Remap(depthBuffer, 0.995f, 1.f);
+	//3. Clipping, the clipped polygon is convex so it is split up as a fan
+	Vertex_Out polygon[m_MaxClipVertices]
+	{
+		FetchVertex(vertices, pVertexStates, i0),
+		FetchVertex(vertices, pVertexStates, i1),
+		FetchVertex(vertices, pVertexStates, i2)
+	};
+	const int numVertices{ ClipPolygon(polygon, 3) };
 
-					//Clamp the depthbuffer to prevent negative values
-					depthBuffer = Clamp(depthBuffer, 0.f, 1.f);
+	for (uint32_t i{ 2 }; i < static_cast<uint32_t>(numVertices); ++i)
+	{
+		Vector4 positions[3]{ polygon[0].position, polygon[i - 1].position, polygon[i].position };
+		uint32_t corners[3]{ 0, i - 1, i };
+		if (!SetupTriangle(frameBuffer, positions, corners, triangle)) continue;
 
-					finalColor = { depthBuffer,depthBuffer,depthBuffer };
-				}
-				else
+		const Vertex_Out* pCornerVertices[3]{ &polygon[corners[0]], &polygon[corners[1]], &polygon[corners[2]] };
+		if (SetupAttributePlanes(pCornerVertices, positions, triangle))
+			triangles.push_back(triangle);
+	}
+}
+
+Vertex_Out Mesh::FetchVertex(const VertexStreams& vertices, VertexState* pVertexStates, uint32_t index) const
+{
+	//Lazy vertex shading: the first thread to need the vertex shades its group, any other one waits the few instructions that takes
+	if (pVertexStates)
+	{
+		const uint32_t group{ index / m_VertexGroupSize };
+		std::atomic_ref<VertexState> state{ pVertexStates[group] };
+
+		VertexState expected{ VertexState::Unshaded };
+		if (state.load(std::memory_order_acquire) != VertexState::Shaded)
+		{
+			if (state.compare_exchange_strong(expected, VertexState::Shading, std::memory_order_acquire))
+			{
+				const uint32_t first{ group * m_VertexGroupSize };
+				const uint32_t last{ std::min(first + m_VertexGroupSize, static_cast<uint32_t>(m_Vertices.size())) };
+
+				m_pMaterial->VertexAttributeShading(m_Vertices, vertices, first, last);
+				state.store(VertexState::Shaded, std::memory_order_release);
+			}
+			else
+			{
+				for (int spins{}; state.load(std::memory_order_acquire) != VertexState::Shaded; ++spins)
 				{
-					Vector3 worldPosition = (w0 * v0.worldPosition + w1 * v1.worldPosition + w2 * v2.worldPosition);
-
-					//Depth correction
-					w0 /= v0.position.w;
-					w1 /= v1.position.w;
-					w2 /= v2.position.w;
-
-					//Calculate depth
-					float depth = 1.f / (w0 + w1 + w2);
-
-					//Update Color in Buffer
-					Vertex_Out temp{};
-					temp.position.x = (float)px;
-					temp.position.y = (float)py;
-					temp.uv = (w0 * v0.uv + w1 * v1.uv + w2 * v2.uv) * depth;
-					temp.normal = ((w0 * v0.normal + w1 * v1.normal + w2 * v2.normal) * depth).Normalized();
-					temp.tangent = ((w0 * v0.tangent + w1 * v1.tangent + w2 * v2.tangent) * depth).Normalized();
-					temp.worldPosition = worldPosition;
-
-					finalColor = m_pMaterial->PixelShading(temp);
+					if (spins < m_MaxVertexSpins)
+					{
+#if defined(DAE_SIMD_X64)
+						_mm_pause();
+#endif
+					}
+					else
+					{
+						std::this_thread::yield();
+					}
 				}
+			}
+		}
+	}
 
-				//Update Color in Buffer
-				finalColor.MaxToOne();
+	return vertices.Gather(index, m_pMaterial->HasSurfaceAttributes());
+}
 
-				m_pBackBufferPixels[px + (py * width)] = SDL_MapRGB(pBackBuffer->format,
-					static_cast<uint8_t>(finalColor.r * 255),
-					static_cast<uint8_t>(finalColor.g * 255),
-					static_cast<uint8_t>(finalColor.b * 255));
-			}
+int Mesh::ClipPolygon(Vertex_Out* pPolygon, int numVertices) const
+{
+	//Clip space planes (inside: dot(plane, position) >= 0): near plane (z >= 0) and the guard band (|x|, |y| <= guardBand * w)
+	const Vector4 planes[]
+	{
+		{ 0.f, 0.f, 1.f, 0.f },
+		{ -1.f, 0.f, 0.f, m_GuardBand },
+		{ 1.f, 0.f, 0.f, m_GuardBand },
+		{ 0.f, -1.f, 0.f, m_GuardBand },
+		{ 0.f, 1.f, 0.f, m_GuardBand }
+	};
+
+	Vertex_Out clipped[m_MaxClipVertices]{};
+	for (const Vector4& plane : planes)
+	{
+		//Sutherland-Hodgman: keep inside vertices, add a vertex wherever an edge crosses the plane
+		int numClipped{};
+		for (int i{}; i < numVertices; ++i)
+		{
+			const Vertex_Out& a{ pPolygon[i] };
+			const Vertex_Out& b{ pPolygon[(i + 1) % numVertices] };
+			const float distanceA{ Vector4::Dot(plane, a.position) };
+			const float distanceB{ Vector4::Dot(plane, b.position) };
+
+			if (distanceA >= 0.f)
+				clipped[numClipped++] = a;
+
+			if ((distanceA >= 0.f) != (distanceB >= 0.f))
+				clipped[numClipped++] = LerpVertex(a, b, distanceA / (distanceA - distanceB));
 		}
+
+		numVertices = numClipped;
+		std::copy(clipped, clipped + numVertices, pPolygon);
+
+		if (numVertices < 3) return 0;
 	}
+
+	return numVertices;
 }
 
-Vertex_Out Mesh::NDCToRaster(const Vertex_Out& v, int width, int heigth) const
+bool Mesh::SetupTriangle(const FrameBuffer& frameBuffer, Vector4* pPositions, uint32_t* pCorners, TriangleSetup& triangle) const
 {
-	Vertex_Out temp{ v };
-	temp.position.x = ((1.f + v.position.x) / 2.f) * width;
-	temp.position.y = ((1.f - v.position.y) / 2.f) * heigth;
-	return temp;
+	// Variables
+	int width{ frameBuffer.width };
+	int height{ frameBuffer.height };
+
+	//1. Clip Space to Raster Space
+	pPositions[0] = ClipToRaster(pPositions[0], width, height);
+	pPositions[1] = ClipToRaster(pPositions[1], width, height);
+	pPositions[2] = ClipToRaster(pPositions[2], width, height);
+
+	//2. Cull Mode, the edge functions expect clockwise triangles so back faces that are drawn get flipped (corners included)
+	const Vector2 edge0{ pPositions[2].GetXY() - pPositions[1].GetXY() };
+	const Vector2 edge1{ pPositions[0].GetXY() - pPositions[2].GetXY() };
+	const bool isFront{ Vector2::Cross(edge0, edge1) > 0.f };
+
+	if (m_CullMode == CullMode::Back && !isFront) return false;
+	if (m_CullMode == CullMode::Front && isFront) return false;
+	if (!isFront)
+	{
+		std::swap(pCorners[1], pCorners[2]);
+		std::swap(pPositions[1], pPositions[2]);
+	}
+
+	triangle.position0 = pPositions[0].GetXY();
+	triangle.position1 = pPositions[1].GetXY();
+	triangle.position2 = pPositions[2].GetXY();
+	triangle.minDepth = std::min(pPositions[0].z, std::min(pPositions[1].z, pPositions[2].z));
+
+	//3. Edge Functions + Bounding Box
+	return m_IsFixedPoint ? SetupEdgesFixed(frameBuffer, triangle) : SetupEdgesFloat(frameBuffer, triangle);
+}
+
+bool Mesh::SetupAttributePlanes(const Vertex_Out* const* pVertices, const Vector4* pPositions, TriangleSetup& triangle) const
+{
+	// Variables
+	const Vertex_Out& v0{ *pVertices[0] };
+	const Vertex_Out& v1{ *pVertices[1] };
+	const Vertex_Out& v2{ *pVertices[2] };
+
+	const float invW0{ 1.f / pPositions[0].w };
+	const float invW1{ 1.f / pPositions[1].w };
+	const float invW2{ 1.f / pPositions[2].w };
+
+	//1. Barycentric weights of vertex 1 and 2 as raster space planes, over the same vertices the edges use
+	//The fixed-point rasterizer samples pixel centers, the float one the pixel corners
+	const float sampleOffset{ m_IsFixedPoint ? 0.5f : 0.f };
+	const Vector2 edge1{ triangle.position1 - triangle.position0 };
+	const Vector2 edge2{ triangle.position2 - triangle.position0 };
+	const Vector2 firstSample{ Vector2{ sampleOffset, sampleOffset } - triangle.position0 };
+
+	//Slivers the snapped edges still cover can have no area left in float
+	const float area{ Vector2::Cross(edge1, edge2) };
+	if (area == 0.f) return false;
+
+	const float invArea{ 1.f / area };
+	AttributePlane weight1{ Vector2::Cross(firstSample, edge2) * invArea, edge2.y * invArea, -edge2.x * invArea };
+	AttributePlane weight2{ Vector2::Cross(edge1, firstSample) * invArea, -edge1.y * invArea, edge1.x * invArea };
+
+	//2. Depth + Perspective, z / w is linear in raster space
+	triangle.depth.Set(pPositions[0].z, pPositions[1].z, pPositions[2].z, weight1, weight2);
+	triangle.invW.Set(invW0, invW1, invW2, weight1, weight2);
+
+	//3. Perspective correct attributes
+	triangle.uvX.Set(v0.uv.x * invW0, v1.uv.x * invW1, v2.uv.x * invW2, weight1, weight2);
+	triangle.uvY.Set(v0.uv.y * invW0, v1.uv.y * invW1, v2.uv.y * invW2, weight1, weight2);
+	if (!m_pMaterial->HasSurfaceAttributes())
+		return true; //The other planes stay zero
+	triangle.normalX.Set(v0.normal.x * invW0, v1.normal.x * invW1, v2.normal.x * invW2, weight1, weight2);
+	triangle.normalY.Set(v0.normal.y * invW0, v1.normal.y * invW1, v2.normal.y * invW2, weight1, weight2);
+	triangle.normalZ.Set(v0.normal.z * invW0, v1.normal.z * invW1, v2.normal.z * invW2, weight1, weight2);
+	triangle.tangentX.Set(v0.tangent.x * invW0, v1.tangent.x * invW1, v2.tangent.x * invW2, weight1, weight2);
+	triangle.tangentY.Set(v0.tangent.y * invW0, v1.tangent.y * invW1, v2.tangent.y * invW2, weight1, weight2);
+	triangle.tangentZ.Set(v0.tangent.z * invW0, v1.tangent.z * invW1, v2.tangent.z * invW2, weight1, weight2);
+
+	//4. Screen space attributes
+	triangle.worldX.Set(v0.worldPosition.x, v1.worldPosition.x, v2.worldPosition.x, weight1, weight2);
+	triangle.worldY.Set(v0.worldPosition.y, v1.worldPosition.y, v2.worldPosition.y, weight1, weight2);
+	triangle.worldZ.Set(v0.worldPosition.z, v1.worldPosition.z, v2.worldPosition.z, weight1, weight2);
+
+	return true;
+}
+
+bool Mesh::SetupEdgesFloat(const FrameBuffer& frameBuffer, TriangleSetup& triangle) const
+{
+	// Variables
+	int width{ frameBuffer.width };
+	int height{ frameBuffer.height };
+
+	const Vector2& p0{ triangle.position0 };
+	const Vector2& p1{ triangle.position1 };
+	const Vector2& p2{ triangle.position2 };
+
+	//1. Calculate Signed Area
+	const float area{ Vector2::Cross(p2 - p1, p0 - p2) };
+	if (area < 0.001f) return false;
+
+	//2. Calculate Bounding Box
+	int left{ (int)std::min(p0.x, std::min(p1.x, p2.x)) };
+	int top{ (int)std::min(p0.y, std::min(p1.y, p2.y)) };
+	int right{ (int)ceilf(std::max(p0.x, std::max(p1.x, p2.x))) };
+	int bottom{ (int)ceilf(std::max(p0.y, std::max(p1.y, p2.y))) };
+
+	if (left < 0) left = 0;
+	if (top < 0) top = 0;
+	if (right >= width) right = width - 1;
+	if (bottom >= height) bottom = height - 1;
+
+	triangle.min = { left, top };
+	triangle.max = { right, bottom };
+
+	return left < right && top < bottom;
+}
+
+bool Mesh::SetupEdgesFixed(const FrameBuffer& frameBuffer, TriangleSetup& triangle) const
+{
+	// Variables
+	constexpr int subPixelBits{ 8 };
+	constexpr int64_t subPixelOne{ 1 << subPixelBits };
+	constexpr int64_t subPixelHalf{ subPixelOne / 2 };
+
+	//1. Snap vertices to the 24.8 grid
+	const int64_t x[3]
+	{
+		std::lrint(triangle.position0.x * subPixelOne),
+		std::lrint(triangle.position1.x * subPixelOne),
+		std::lrint(triangle.position2.x * subPixelOne)
+	};
+	const int64_t y[3]
+	{
+		std::lrint(triangle.position0.y * subPixelOne),
+		std::lrint(triangle.position1.y * subPixelOne),
+		std::lrint(triangle.position2.y * subPixelOne)
+	};
+
+	//2. Calculate Signed Area (16.16), degenerate and back facing triangles have no area
+	const int64_t area{ (x[2] - x[1]) * (y[0] - y[2]) - (y[2] - y[1]) * (x[0] - x[2]) };
+	if (area <= 0) return false;
+
+	//The attribute planes are set up from the snapped vertices too, so they agree with the coverage
+	triangle.position0 = { x[0] / static_cast<float>(subPixelOne), y[0] / static_cast<float>(subPixelOne) };
+	triangle.position1 = { x[1] / static_cast<float>(subPixelOne), y[1] / static_cast<float>(subPixelOne) };
+	triangle.position2 = { x[2] / static_cast<float>(subPixelOne), y[2] / static_cast<float>(subPixelOne) };
+
+	//3. Calculate Bounding Box of the covered pixel centers
+	const int64_t minX{ std::min(x[0], std::min(x[1], x[2])) };
+	const int64_t minY{ std::min(y[0], std::min(y[1], y[2])) };
+	const int64_t maxX{ std::max(x[0], std::max(x[1], x[2])) };
+	const int64_t maxY{ std::max(y[0], std::max(y[1], y[2])) };
+
+	int left{ static_cast<int>((minX - subPixelHalf + subPixelOne - 1) >> subPixelBits) };
+	int top{ static_cast<int>((minY - subPixelHalf + subPixelOne - 1) >> subPixelBits) };
+	int right{ static_cast<int>((maxX - subPixelHalf) >> subPixelBits) + 1 };
+	int bottom{ static_cast<int>((maxY - subPixelHalf) >> subPixelBits) + 1 };
+
+	left = std::max(left, 0);
+	top = std::max(top, 0);
+	right = std::min(right, frameBuffer.width);
+	bottom = std::min(bottom, frameBuffer.height);
+
+	triangle.min = { left, top };
+	triangle.max = { right, bottom };
+
+	//4. Edge Functions, edge i is opposite to vertex i (same winding as the float edges)
+	//E(p) = dx * (p.y - a.y) - dy * (p.x - a.x), evaluated at pixel centers
+	for (int i{}; i < 3; ++i)
+	{
+		const int a{ (i + 1) % 3 };
+		const int b{ (i + 2) % 3 };
+		const int64_t dx{ x[b] - x[a] };
+		const int64_t dy{ y[b] - y[a] };
+
+		//Top-left rule: pixel centers exactly on an edge only belong to the triangle if it is a top or left edge
+		//In raster space (y down) with this winding, top edges run to the right, left edges run up
+		const bool isTopLeft{ (dy == 0 && dx > 0) || dy < 0 };
+
+		triangle.edgeStepX[i] = -dy * subPixelOne;
+		triangle.edgeStepY[i] = dx * subPixelOne;
+		triangle.edgeOrigin[i] = dx * (subPixelHalf - y[a]) - dy * (subPixelHalf - x[a]) + (isTopLeft ? 0 : -1);
+	}
+
+	return left < right && top < bottom;
 }
 
-bool Mesh::FrustumCulling(const Vector4& v) const
+Mesh::RenderTriangleFunction Mesh::SelectRenderTriangle() const
 {
-	if (v.x < -1.f || v.x > 1.f) return true;
-	if (v.y < -1.f || v.y > 1.f) return true;
-	if (v.z < 0.f || v.z > 1.f) return true;
+	if (m_IsShowBoundingBox)
+		return &Mesh::RenderBoundingBox;
+
+	//1. What the pixels write (deferred: the depth view is applied when the visible pixels get shaded)
+	PixelOutput output{ PixelOutput::Color };
+	if (m_IsTransparent)
+		output = m_IsWeightedBlended ? PixelOutput::Accumulate : PixelOutput::Blend;
+	else if (m_IsDeferred)
+		output = PixelOutput::Visibility;
+	else if (m_IsShowDepthBuffer)
+		output = PixelOutput::Depth;
+
+	//2. Edge functions, the widest kernel the cpu supports
+	PixelKernel kernel{ PixelKernel::Float };
+	if (m_IsFixedPoint)
+	{
+		switch (SIMD::GetLevel())
+		{
+		case SIMDLevel::avx2:
+			kernel = PixelKernel::FixedAVX2;
+			break;
+		case SIMDLevel::sse2:
+			kernel = PixelKernel::FixedSSE2;
+			break;
+		default:
+			kernel = PixelKernel::Fixed;
+			break;
+		}
+	}
+
+	return m_RenderTriangleFunctions[static_cast<int>(output)][static_cast<int>(kernel)];
+}
+
+void Mesh::RenderBoundingBox(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& tileMin, const Int2& tileMax, PipelineStats&) const
+{
+	// Variables
+	int width{ frameBuffer.width };
+
+	//1. Clip Bounding Box to Tile
+	int left{ std::max(triangle.min.x, tileMin.x) };
+	int top{ std::max(triangle.min.y, tileMin.y) };
+	int right{ std::min(triangle.max.x, tileMax.x) };
+	int bottom{ std::min(triangle.max.y, tileMax.y) };
+
+	//2. BoundingBox Visualization
+	const uint32_t white{ frameBuffer.MapRGB(
+		static_cast<uint8_t>(255),
+		static_cast<uint8_t>(255),
+		static_cast<uint8_t>(255)) };
+
+	for (int py{ top }; py < bottom; ++py)
+	{
+		std::fill(frameBuffer.pPixels + left + (py * width), frameBuffer.pPixels + right + (py * width), white);
+	}
+}
+
+template<Mesh::PixelOutput output, Mesh::PixelKernel kernel>
+void Mesh::RenderTriangle(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& tileMin, const Int2& tileMax, PipelineStats& stats) const
+{
+	//1. Clip Bounding Box to Tile
+	int left{ std::max(triangle.min.x, tileMin.x) };
+	int top{ std::max(triangle.min.y, tileMin.y) };
+	int right{ std::min(triangle.max.x, tileMax.x) };
+	int bottom{ std::min(triangle.max.y, tileMax.y) };
+
+	//2. Hi-Z: the whole triangle is behind everything already drawn in its part of the tile
+	++stats.numBinned;
+	if (triangle.minDepth >= frameBuffer.pHiZBuffer->GetMaxDepth(frameBuffer.pDepthPixels, { left, top }, { right, bottom }))
+	{
+		++stats.numHiZTriangles;
+		return;
+	}
+
+	//3. Render Pixels
+	if constexpr (kernel == PixelKernel::Float)
+		RenderPixelsFloat<output>(frameBuffer, triangle, { left, top }, { right, bottom });
+	else
+		RenderBlocksFixed<output, kernel>(frameBuffer, triangle, { left, top }, { right, bottom }, stats);
+
+	//Transparency leaves the depth buffer as it is
+	if constexpr (IsDepthWritten(output))
+		frameBuffer.pHiZBuffer->MarkDirty({ left, top }, { right, bottom });
+}
+
+template<Mesh::PixelOutput output, Mesh::PixelKernel kernel>
+void Mesh::RenderBlocksFixed(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max, PipelineStats& stats) const
+{
+	// Variables
+	const int64_t* stepX{ triangle.edgeStepX };
+	const int64_t* stepY{ triangle.edgeStepY };
+
+	//Small triangles cannot fully cover a block, classifying them would only split them up
+	if (max.x - min.x <= 2 * m_BlockSize || max.y - min.y <= 2 * m_BlockSize)
+	{
+		RenderPixelsFixedKernel<output, kernel>(frameBuffer, triangle, min, max, false);
+		return;
+	}
+
+	//1. Edges are linear, so over a block they are smallest and largest at two of its corner pixel centers
+	int64_t cornerMin[3]{};
+	int64_t cornerMax[3]{};
+	for (int i{}; i < 3; ++i)
+	{
+		const int64_t cornerX{ (m_BlockSize - 1) * stepX[i] };
+		const int64_t cornerY{ (m_BlockSize - 1) * stepY[i] };
+
+		cornerMin[i] = std::min(cornerX, int64_t{}) + std::min(cornerY, int64_t{});
+		cornerMax[i] = std::max(cornerX, int64_t{}) + std::max(cornerY, int64_t{});
+	}
+
+	//2. Classify the blocks (aligned to the tile grid), only partially covered blocks test every pixel
+	for (int blockY{ min.y & ~(m_BlockSize - 1) }; blockY < max.y; blockY += m_BlockSize)
+	{
+		for (int blockX{ min.x & ~(m_BlockSize - 1) }; blockX < max.x; blockX += m_BlockSize)
+		{
+			bool isOutside{ false };
+			bool isCovered{ true };
+			for (int i{}; i < 3; ++i)
+			{
+				const int64_t edgeValue{ triangle.edgeOrigin[i] + blockX * stepX[i] + blockY * stepY[i] };
+
+				if (edgeValue + cornerMax[i] < 0) isOutside = true;
+				if (edgeValue + cornerMin[i] < 0) isCovered = false;
+			}
+
+			//Trivial reject
+			if (isOutside) continue;
+
+			//Hi-Z reject
+			if (triangle.minDepth >= frameBuffer.pHiZBuffer->GetBlockMaxDepth(frameBuffer.pDepthPixels, blockX / m_BlockSize, blockY / m_BlockSize))
+			{
+				++stats.numHiZBlocks;
+				continue;
+			}
+
+			const Int2 blockMin{ std::max(blockX, min.x), std::max(blockY, min.y) };
+			const Int2 blockMax{ std::min(blockX + m_BlockSize, max.x), std::min(blockY + m_BlockSize, max.y) };
+
+			//Trivial accept or per pixel test
+			RenderPixelsFixedKernel<output, kernel>(frameBuffer, triangle, blockMin, blockMax, isCovered);
+		}
+	}
+}
+
+template<Mesh::PixelOutput output, Mesh::PixelKernel kernel>
+void Mesh::RenderPixelsFixedKernel(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max, bool isCovered) const
+{
+	//SelectRenderTriangle only picks the SIMD kernels on cpus that support them
+#if defined(DAE_SIMD_X64)
+	if constexpr (kernel == PixelKernel::FixedAVX2)
+	{
+		RenderPixelsFixedAVX2<output>(frameBuffer, triangle, min, max, isCovered);
+		return;
+	}
+	else if constexpr (kernel == PixelKernel::FixedSSE2)
+	{
+		RenderPixelsFixedSSE2<output>(frameBuffer, triangle, min, max, isCovered);
+		return;
+	}
+#endif
+
+	RenderPixelsFixed<output>(frameBuffer, triangle, min, max, isCovered);
+}
+
+template<Mesh::PixelOutput output>
+void Mesh::RenderPixelsFloat(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max) const
+{
+	// Variables
+	const Vector2 edge0{ triangle.position2 - triangle.position1 };
+	const Vector2 edge1{ triangle.position0 - triangle.position2 };
+	const Vector2 edge2{ triangle.position1 - triangle.position0 };
+
+	//1. Evaluate the edge functions once, at the top-left pixel of the first quad
+	//Moving one pixel right adds -edge.y, moving one row down adds edge.x
+	const Int2 quadStart{ min.x & ~1, min.y & ~1 };
+	const Vector2 firstPixel{ (float)quadStart.x, (float)quadStart.y };
+	float edgeRow0{ Vector2::Cross(edge0, firstPixel - triangle.position1) };
+	float edgeRow1{ Vector2::Cross(edge1, firstPixel - triangle.position2) };
+	float edgeRow2{ Vector2::Cross(edge2, firstPixel - triangle.position0) };
+
+	//2. Render Quads (2x2 pixels, pairs of rows in memory order), pixels outside [min, max) are only helpers
+	PixelBatch batch{};
+	for (int qy{ quadStart.y }; qy < max.y; qy += 2)
+	{
+		float edgeQuad0{ edgeRow0 };
+		float edgeQuad1{ edgeRow1 };
+		float edgeQuad2{ edgeRow2 };
+
+		edgeRow0 += 2.f * edge0.x;
+		edgeRow1 += 2.f * edge1.x;
+		edgeRow2 += 2.f * edge2.x;
+
+		for (int qx{ quadStart.x }; qx < max.x; qx += 2, edgeQuad0 -= 2.f * edge0.y, edgeQuad1 -= 2.f * edge1.y, edgeQuad2 -= 2.f * edge2.y)
+		{
+			int quadMask{};
+			for (int lane{}; lane < PixelLanes::quadSize; ++lane)
+			{
+				const int px{ qx + (lane & 1) };
+				const int py{ qy + (lane >> 1) };
+				if (px < min.x || px >= max.x || py < min.y || py >= max.y) continue;
+
+				//Check if pixel is inside triangle
+				const float offsetX{ static_cast<float>(lane & 1) };
+				const float offsetY{ static_cast<float>(lane >> 1) };
+				if (edgeQuad0 - offsetX * edge0.y + offsetY * edge0.x < 0.f) continue;
+				if (edgeQuad1 - offsetX * edge1.y + offsetY * edge1.x < 0.f) continue;
+				if (edgeQuad2 - offsetX * edge2.y + offsetY * edge2.x < 0.f) continue;
+
+				if (DepthTest(frameBuffer, triangle, px, py, IsDepthWritten(output)))
+					quadMask |= 1 << lane;
+			}
+
+			if (quadMask != 0)
+				ShadeQuad<output>(frameBuffer, triangle, qx, qy, quadMask, batch);
+		}
+	}
+
+	//3. Shade what is left in the batch
+	if constexpr (IsShaded(output))
+		ShadeBatch<output>(frameBuffer, batch);
+}
+
+template<Mesh::PixelOutput output>
+void Mesh::RenderPixelsFixed(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max, bool isCovered) const
+{
+	// Variables
+	const int64_t* stepX{ triangle.edgeStepX };
+	const int64_t* stepY{ triangle.edgeStepY };
+
+	//1. Evaluate the edge functions once, at the top-left pixel center of the first quad
+	//Integer stepping is exact, so the result does not depend on where a tile starts
+	const Int2 quadStart{ min.x & ~1, min.y & ~1 };
+	int64_t edgeRow[3]{};
+	for (int i{}; i < 3; ++i)
+	{
+		edgeRow[i] = triangle.edgeOrigin[i] + quadStart.x * stepX[i] + quadStart.y * stepY[i];
+	}
+
+	//2. Render Quads (2x2 pixels, pairs of rows in memory order), pixels outside [min, max) are only helpers
+	PixelBatch batch{};
+	for (int qy{ quadStart.y }; qy < max.y; qy += 2)
+	{
+		int64_t edgeQuad[3]{ edgeRow[0], edgeRow[1], edgeRow[2] };
+		for (int i{}; i < 3; ++i)
+		{
+			edgeRow[i] += 2 * stepY[i];
+		}
+
+		for (int qx{ quadStart.x }; qx < max.x; qx += 2)
+		{
+			int quadMask{};
+			for (int lane{}; lane < PixelLanes::quadSize; ++lane)
+			{
+				const int px{ qx + (lane & 1) };
+				const int py{ qy + (lane >> 1) };
+				if (px < min.x || px >= max.x || py < min.y || py >= max.y) continue;
+
+				//Check if pixel center is inside triangle (the top-left bias is already part of the edge values)
+				if (!isCovered)
+				{
+					int64_t edgeSigns{};
+					for (int i{}; i < 3; ++i)
+					{
+						edgeSigns |= edgeQuad[i] + (lane & 1) * stepX[i] + (lane >> 1) * stepY[i];
+					}
+					if (edgeSigns < 0) continue;
+				}
+
+				if (DepthTest(frameBuffer, triangle, px, py, IsDepthWritten(output)))
+					quadMask |= 1 << lane;
+			}
+
+			for (int i{}; i < 3; ++i)
+			{
+				edgeQuad[i] += 2 * stepX[i];
+			}
+
+			if (quadMask != 0)
+				ShadeQuad<output>(frameBuffer, triangle, qx, qy, quadMask, batch);
+		}
+	}
+
+	//3. Shade what is left in the batch
+	if constexpr (IsShaded(output))
+		ShadeBatch<output>(frameBuffer, batch);
+}
+
+#if defined(DAE_SIMD_X64)
+template<Mesh::PixelOutput output>
+void Mesh::RenderPixelsFixedSSE2(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max, bool isCovered) const
+{
+	//One quad per step
+	constexpr int stepWidth{ 2 };
+
+	if (!HasLaneSafeSteps(triangle, stepWidth))
+	{
+		RenderPixelsFixed<output>(frameBuffer, triangle, min, max, isCovered);
+		return;
+	}
+
+	// Variables
+	const int width{ frameBuffer.width };
+	const int height{ frameBuffer.height };
+	const int64_t* stepX{ triangle.edgeStepX };
+	const int64_t* stepY{ triangle.edgeStepY };
+
+	const __m128 zero{ _mm_setzero_ps() };
+	const __m128 one{ _mm_set1_ps(1.f) };
+
+	//1. Lane offsets: coverage steps exactly in integers, the attribute planes are evaluated at the lane's pixel
+	const __m128i laneX{ _mm_setr_epi32(0, 1, 0, 1) };
+	const __m128i laneY{ _mm_setr_epi32(0, 0, 1, 1) };
+	const __m128 laneXf{ _mm_cvtepi32_ps(laneX) };
+	const __m128 laneYf{ _mm_cvtepi32_ps(laneY) };
+
+	__m128i edgeLaneStep[3]{};
+	for (int i{}; i < 3; ++i)
+	{
+		const int32_t stepRight{ static_cast<int32_t>(stepX[i]) };
+		const int32_t stepDown{ static_cast<int32_t>(stepY[i]) };
+		edgeLaneStep[i] = _mm_setr_epi32(0, stepRight, stepDown, stepRight + stepDown);
+	}
+
+	const __m128i minX{ _mm_set1_epi32(min.x - 1) };
+	const __m128i maxX{ _mm_set1_epi32(max.x) };
+	const __m128i minY{ _mm_set1_epi32(min.y - 1) };
+	const __m128i maxY{ _mm_set1_epi32(max.y) };
+
+	//2. Render Quads (pairs of rows, aligned to the tile so neighbouring tiles are never touched)
+	const Int2 quadStart{ min.x & ~1, min.y & ~1 };
+
+	PixelBatch batch{};
+	for (int py{ quadStart.y }; py < max.y; py += 2)
+	{
+		//Quads reaching past the last row of the framebuffer are finished scalar
+		if (py + 2 > height)
+		{
+			RenderPixelsFixed<output>(frameBuffer, triangle, { min.x, std::max(py, min.y) }, max, isCovered);
+			break;
+		}
+
+		float* pDepthRow{ frameBuffer.pDepthPixels + (py * width) };
+		const __m128i pixelY{ _mm_add_epi32(_mm_set1_epi32(py), laneY) };
+		const __m128 pixelYf{ _mm_add_ps(_mm_set1_ps(static_cast<float>(py)), laneYf) };
+		const __m128i rowCoverage{ _mm_and_si128(_mm_cmpgt_epi32(pixelY, minY), _mm_cmpgt_epi32(maxY, pixelY)) };
+
+		int64_t edgeQuad[3]{};
+		for (int i{}; i < 3; ++i)
+		{
+			edgeQuad[i] = triangle.edgeOrigin[i] + quadStart.x * stepX[i] + py * stepY[i];
+		}
+
+		for (int px{ quadStart.x }; px < max.x; px += stepWidth)
+		{
+			//The last quad of a row pair that is not a multiple of the step is finished scalar
+			if (px + stepWidth > width)
+			{
+				RenderPixelsFixed<output>(frameBuffer, triangle, { std::max(px, min.x), std::max(py, min.y) }, { max.x, std::min(py + 2, max.y) }, isCovered);
+				break;
+			}
+
+			//a. Coverage: inside the bounding box and, unless the whole block is covered, on the inner side of all edges
+			const __m128i pixelX{ _mm_add_epi32(_mm_set1_epi32(px), laneX) };
+			__m128i coverage{ _mm_and_si128(rowCoverage, _mm_and_si128(_mm_cmpgt_epi32(pixelX, minX), _mm_cmpgt_epi32(maxX, pixelX))) };
+
+			__m128i edgeSigns{ _mm_setzero_si128() };
+			for (int i{}; i < 3; ++i)
+			{
+				if (!isCovered)
+				{
+					const __m128i edgeValue{ _mm_add_epi32(_mm_set1_epi32(ClampToLane(edgeQuad[i])), edgeLaneStep[i]) };
+					edgeSigns = _mm_or_si128(edgeSigns, edgeValue);
+				}
+
+				edgeQuad[i] += stepWidth * stepX[i];
+			}
+			if (!isCovered) coverage = _mm_andnot_si128(_mm_srai_epi32(edgeSigns, 31), coverage);
+
+			if (_mm_movemask_epi8(coverage) == 0) continue;
+
+			//b. Depth Test
+			const __m128 pixelXf{ _mm_add_ps(_mm_set1_ps(static_cast<float>(px)), laneXf) };
+			const __m128 depth{ Evaluate4(triangle.depth, pixelXf, pixelYf) };
+			const __m128 oldDepth{ LoadQuad(pDepthRow + px, pDepthRow + px + width) };
+
+			__m128 pass{ _mm_and_ps(_mm_castsi128_ps(coverage), _mm_and_ps(_mm_cmpge_ps(depth, zero), _mm_cmple_ps(depth, one))) };
+			pass = _mm_and_ps(pass, _mm_cmplt_ps(depth, oldDepth));
+
+			const int pixelMask{ _mm_movemask_ps(pass) };
+			if (pixelMask == 0) continue;
+
+			//c. Depth Write (the whole quad belongs to this tile, so a blended store is safe), transparency only tests
+			if constexpr (IsDepthWritten(output))
+				StoreQuad(pDepthRow + px, pDepthRow + px + width, _mm_or_ps(_mm_and_ps(pass, depth), _mm_andnot_ps(pass, oldDepth)));
+
+			//d. Interpolate Attributes of every lane, helpers included, into the next slot of the batch
+			//Deferred: nothing, the planes are evaluated again once the pixel is known to be visible
+			if constexpr (IsShaded(output))
+			{
+				PixelLanes& lanes{ batch.lanes };
+				const int first{ batch.numQuads * PixelLanes::quadSize };
+
+				_mm_store_ps(lanes.worldX + first, Evaluate4(triangle.worldX, pixelXf, pixelYf));
+				_mm_store_ps(lanes.worldY + first, Evaluate4(triangle.worldY, pixelXf, pixelYf));
+				_mm_store_ps(lanes.worldZ + first, Evaluate4(triangle.worldZ, pixelXf, pixelYf));
+
+				//Depth correction
+				const __m128 correction{ _mm_div_ps(one, Evaluate4(triangle.invW, pixelXf, pixelYf)) };
+				if constexpr (output == PixelOutput::Accumulate)
+					_mm_store_ps(batch.viewDepths + first, correction);
+
+				_mm_store_ps(lanes.uvX + first, _mm_mul_ps(Evaluate4(triangle.uvX, pixelXf, pixelYf), correction));
+				_mm_store_ps(lanes.uvY + first, _mm_mul_ps(Evaluate4(triangle.uvY, pixelXf, pixelYf), correction));
+				_mm_store_ps(lanes.normalX + first, _mm_mul_ps(Evaluate4(triangle.normalX, pixelXf, pixelYf), correction));
+				_mm_store_ps(lanes.normalY + first, _mm_mul_ps(Evaluate4(triangle.normalY, pixelXf, pixelYf), correction));
+				_mm_store_ps(lanes.normalZ + first, _mm_mul_ps(Evaluate4(triangle.normalZ, pixelXf, pixelYf), correction));
+				_mm_store_ps(lanes.tangentX + first, _mm_mul_ps(Evaluate4(triangle.tangentX, pixelXf, pixelYf), correction));
+				_mm_store_ps(lanes.tangentY + first, _mm_mul_ps(Evaluate4(triangle.tangentY, pixelXf, pixelYf), correction));
+				_mm_store_ps(lanes.tangentZ + first, _mm_mul_ps(Evaluate4(triangle.tangentZ, pixelXf, pixelYf), correction));
+			}
+
+			//e. Shade the pixels that passed
+			EmitQuad<output>(frameBuffer, triangle, px, py, pixelMask, batch);
+		}
+	}
+
+	//3. Shade what is left in the batch
+	if constexpr (IsShaded(output))
+		ShadeBatch<output>(frameBuffer, batch);
+}
+
+template<Mesh::PixelOutput output>
+DAE_TARGET_AVX2 void Mesh::RenderPixelsFixedAVX2(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max, bool isCovered) const
+{
+	//Two quads side by side per step, a whole batch
+	constexpr int stepWidth{ 4 };
+	static_assert(PixelLanes::numQuads == 2, "Every step fills the batch");
+
+	if (!HasLaneSafeSteps(triangle, stepWidth))
+	{
+		RenderPixelsFixed<output>(frameBuffer, triangle, min, max, isCovered);
+		return;
+	}
+
+	// Variables
+	const int width{ frameBuffer.width };
+	const int height{ frameBuffer.height };
+	const int64_t* stepX{ triangle.edgeStepX };
+	const int64_t* stepY{ triangle.edgeStepY };
+
+	const __m256 zero{ _mm256_setzero_ps() };
+	const __m256 one{ _mm256_set1_ps(1.f) };
+
+	//1. Lane offsets: coverage steps exactly in integers, the attribute planes are evaluated at the lane's pixel
+	const __m256i laneX{ _mm256_setr_epi32(0, 1, 0, 1, 2, 3, 2, 3) };
+	const __m256i laneY{ _mm256_setr_epi32(0, 0, 1, 1, 0, 0, 1, 1) };
+	const __m256 laneXf{ _mm256_cvtepi32_ps(laneX) };
+	const __m256 laneYf{ _mm256_cvtepi32_ps(laneY) };
+
+	__m256i edgeLaneStep[3]{};
+	for (int i{}; i < 3; ++i)
+	{
+		const __m256i stepRight{ _mm256_mullo_epi32(laneX, _mm256_set1_epi32(static_cast<int32_t>(stepX[i]))) };
+		const __m256i stepDown{ _mm256_mullo_epi32(laneY, _mm256_set1_epi32(static_cast<int32_t>(stepY[i]))) };
+		edgeLaneStep[i] = _mm256_add_epi32(stepRight, stepDown);
+	}
+
+	const __m256i minX{ _mm256_set1_epi32(min.x - 1) };
+	const __m256i maxX{ _mm256_set1_epi32(max.x) };
+	const __m256i minY{ _mm256_set1_epi32(min.y - 1) };
+	const __m256i maxY{ _mm256_set1_epi32(max.y) };
+
+	//2. Render Quads (pairs of rows, aligned to the tile so neighbouring tiles are never touched)
+	const Int2 quadStart{ min.x & ~(stepWidth - 1), min.y & ~1 };
+
+	PixelBatch batch{};
+	for (int py{ quadStart.y }; py < max.y; py += 2)
+	{
+		//Quads reaching past the last row of the framebuffer are finished scalar
+		if (py + 2 > height)
+		{
+			RenderPixelsFixed<output>(frameBuffer, triangle, { min.x, std::max(py, min.y) }, max, isCovered);
+			break;
+		}
+
+		float* pDepthRow{ frameBuffer.pDepthPixels + (py * width) };
+		const __m256i pixelY{ _mm256_add_epi32(_mm256_set1_epi32(py), laneY) };
+		const __m256 pixelYf{ _mm256_add_ps(_mm256_set1_ps(static_cast<float>(py)), laneYf) };
+		const __m256i rowCoverage{ _mm256_and_si256(_mm256_cmpgt_epi32(pixelY, minY), _mm256_cmpgt_epi32(maxY, pixelY)) };
+
+		int64_t edgeQuad[3]{};
+		for (int i{}; i < 3; ++i)
+		{
+			edgeQuad[i] = triangle.edgeOrigin[i] + quadStart.x * stepX[i] + py * stepY[i];
+		}
+
+		for (int px{ quadStart.x }; px < max.x; px += stepWidth)
+		{
+			//The last quads of a row pair that is not a multiple of the step are finished scalar
+			if (px + stepWidth > width)
+			{
+				RenderPixelsFixed<output>(frameBuffer, triangle, { std::max(px, min.x), std::max(py, min.y) }, { max.x, std::min(py + 2, max.y) }, isCovered);
+				break;
+			}
+
+			//a. Coverage: inside the bounding box and, unless the whole block is covered, on the inner side of all edges
+			const __m256i pixelX{ _mm256_add_epi32(_mm256_set1_epi32(px), laneX) };
+			__m256i coverage{ _mm256_and_si256(rowCoverage, _mm256_and_si256(_mm256_cmpgt_epi32(pixelX, minX), _mm256_cmpgt_epi32(maxX, pixelX))) };
+
+			__m256i edgeSigns{ _mm256_setzero_si256() };
+			for (int i{}; i < 3; ++i)
+			{
+				if (!isCovered)
+				{
+					const __m256i edgeValue{ _mm256_add_epi32(_mm256_set1_epi32(ClampToLane(edgeQuad[i])), edgeLaneStep[i]) };
+					edgeSigns = _mm256_or_si256(edgeSigns, edgeValue);
+				}
+
+				edgeQuad[i] += stepWidth * stepX[i];
+			}
+			if (!isCovered) coverage = _mm256_andnot_si256(_mm256_srai_epi32(edgeSigns, 31), coverage);
+
+			if (_mm256_testz_si256(coverage, coverage)) continue;
+
+			//b. Depth Test
+			const __m256 pixelXf{ _mm256_add_ps(_mm256_set1_ps(static_cast<float>(px)), laneXf) };
+			const __m256 depth{ Evaluate8(triangle.depth, pixelXf, pixelYf) };
+			const __m256 oldDepth{ LoadQuads(pDepthRow + px, pDepthRow + px + width) };
+
+			__m256 pass{ _mm256_and_ps(_mm256_castsi256_ps(coverage), _mm256_and_ps(_mm256_cmp_ps(depth, zero, _CMP_GE_OQ), _mm256_cmp_ps(depth, one, _CMP_LE_OQ))) };
+			pass = _mm256_and_ps(pass, _mm256_cmp_ps(depth, oldDepth, _CMP_LT_OQ));
+
+			const int pixelMask{ _mm256_movemask_ps(pass) };
+			if (pixelMask == 0) continue;
+
+			//c. Depth Write (the whole step belongs to this tile, so a blended store is safe), transparency only tests
+			if constexpr (IsDepthWritten(output))
+				StoreQuads(pDepthRow + px, pDepthRow + px + width, _mm256_blendv_ps(oldDepth, depth, pass));
+
+			//d. Interpolate Attributes of every lane, helpers included, into the (empty) batch
+			//Deferred: nothing, the planes are evaluated again once the pixel is known to be visible
+			if constexpr (IsShaded(output))
+			{
+				PixelLanes& lanes{ batch.lanes };
+
+				_mm256_store_ps(lanes.worldX, Evaluate8(triangle.worldX, pixelXf, pixelYf));
+				_mm256_store_ps(lanes.worldY, Evaluate8(triangle.worldY, pixelXf, pixelYf));
+				_mm256_store_ps(lanes.worldZ, Evaluate8(triangle.worldZ, pixelXf, pixelYf));
+
+				//Depth correction
+				const __m256 correction{ _mm256_div_ps(one, Evaluate8(triangle.invW, pixelXf, pixelYf)) };
+				if constexpr (output == PixelOutput::Accumulate)
+					_mm256_store_ps(batch.viewDepths, correction);
+
+				_mm256_store_ps(lanes.uvX, _mm256_mul_ps(Evaluate8(triangle.uvX, pixelXf, pixelYf), correction));
+				_mm256_store_ps(lanes.uvY, _mm256_mul_ps(Evaluate8(triangle.uvY, pixelXf, pixelYf), correction));
+				_mm256_store_ps(lanes.normalX, _mm256_mul_ps(Evaluate8(triangle.normalX, pixelXf, pixelYf), correction));
+				_mm256_store_ps(lanes.normalY, _mm256_mul_ps(Evaluate8(triangle.normalY, pixelXf, pixelYf), correction));
+				_mm256_store_ps(lanes.normalZ, _mm256_mul_ps(Evaluate8(triangle.normalZ, pixelXf, pixelYf), correction));
+				_mm256_store_ps(lanes.tangentX, _mm256_mul_ps(Evaluate8(triangle.tangentX, pixelXf, pixelYf), correction));
+				_mm256_store_ps(lanes.tangentY, _mm256_mul_ps(Evaluate8(triangle.tangentY, pixelXf, pixelYf), correction));
+				_mm256_store_ps(lanes.tangentZ, _mm256_mul_ps(Evaluate8(triangle.tangentZ, pixelXf, pixelYf), correction));
+			}
+
+			//e. Shade the pixels that passed, both quads even if one has none, the attributes fill both slots
+			EmitQuad<output>(frameBuffer, triangle, px, py, pixelMask & 0xF, batch);
+			EmitQuad<output>(frameBuffer, triangle, px + 2, py, pixelMask >> 4, batch);
+		}
+	}
+}
+#endif
+
+bool Mesh::DepthTest(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, int px, int py, bool isDepthWrite) const
+{
+	// Variables
+	const int pixelIndex{ px + (py * frameBuffer.width) };
+
+	//1. Calculate depth buffer
+	float depthBuffer = triangle.depth.Evaluate(static_cast<float>(px), static_cast<float>(py));
+
+	if (depthBuffer < 0 || depthBuffer > 1) return false;
+
+	//2. Depth Test
+	if (depthBuffer >= frameBuffer.pDepthPixels[pixelIndex]) return false;
+
+	//3. Depth Write
+	if (isDepthWrite)
+		frameBuffer.pDepthPixels[pixelIndex] = depthBuffer;
+	return true;
+}
+
+template<Mesh::PixelOutput output>
+void Mesh::ShadeQuad(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, int qx, int qy, int quadMask, PixelBatch& batch) const
+{
+	//Every lane of the quad gets its attributes, the helper lanes only feed the derivatives
+	if constexpr (IsShaded(output))
+	{
+		const int first{ batch.numQuads * PixelLanes::quadSize };
+		for (int lane{}; lane < PixelLanes::quadSize; ++lane)
+		{
+			const float viewDepth{ InterpolateAttributes(triangle, qx + (lane & 1), qy + (lane >> 1), batch.lanes, first + lane) };
+			if constexpr (output == PixelOutput::Accumulate)
+				batch.viewDepths[first + lane] = viewDepth;
+		}
+	}
+
+	EmitQuad<output>(frameBuffer, triangle, qx, qy, quadMask, batch);
+}
+
+template<Mesh::PixelOutput output>
+void Mesh::EmitQuad(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, int qx, int qy, int quadMask, PixelBatch& batch) const
+{
+	const int quadIndex{ qx + (qy * frameBuffer.width) };
+
+	//Shaded: the attributes (and view depths) are in the next slot of the batch already, the pixel shader runs once the batch is full
+	if constexpr (IsShaded(output))
+	{
+		batch.quadIndices[batch.numQuads] = quadIndex;
+		batch.pixelMask |= quadMask << (batch.numQuads * PixelLanes::quadSize);
+
+		if (++batch.numQuads == PixelLanes::numQuads)
+			ShadeBatch<output>(frameBuffer, batch);
+	}
+	else
+	{
+		for (int lane{}; quadMask != 0; ++lane, quadMask >>= 1)
+		{
+			if ((quadMask & 1) == 0) continue;
+
+			const int pixelIndex{ quadIndex + (lane & 1) + ((lane >> 1) * frameBuffer.width) };
+
+			//Deferred: only remember the visible triangle, it gets shaded once every triangle is drawn
+			if constexpr (output == PixelOutput::Visibility)
+				frameBuffer.pTriangleIds[pixelIndex] = triangle.id;
+			else
+				WritePixel(frameBuffer, pixelIndex, DepthToColor(frameBuffer.pDepthPixels[pixelIndex]));
+		}
+	}
+}
+
+template<Mesh::PixelOutput output>
+void Mesh::ShadeVisibleQuads(const FrameBuffer& frameBuffer, const TriangleSetup* const* pTriangleTable, int qy) const
+{
+	PixelBatch batch{};
+	for (int qx{}; qx < frameBuffer.width; qx += 2)
+	{
+		//1. Visible triangle of every pixel in the quad
+		//Only the pixels this draw left visible, other meshes may share the buffer
+		uint32_t ids[PixelLanes::quadSize]{};
+		int visibleMask{};
+		for (int lane{}; lane < PixelLanes::quadSize; ++lane)
+		{
+			const int px{ qx + (lane & 1) };
+			const int py{ qy + (lane >> 1) };
+			if (px >= frameBuffer.width || py >= frameBuffer.height) continue;
+
+			const int pixelIndex{ px + (py * frameBuffer.width) };
+			ids[lane] = frameBuffer.pTriangleIds[pixelIndex];
+			if (ids[lane] == FrameBuffer::noTriangle) continue;
+
+			frameBuffer.pTriangleIds[pixelIndex] = FrameBuffer::noTriangle;
+			visibleMask |= 1 << lane;
+		}
+
+		//2. One quad per triangle in it, its other pixels are helpers (like the triangle drawn forward)
+		while (visibleMask != 0)
+		{
+			int lane{};
+			while ((visibleMask & (1 << lane)) == 0) ++lane;
+
+			const uint32_t id{ ids[lane] };
+			int quadMask{};
+			for (; lane < PixelLanes::quadSize; ++lane)
+			{
+				if ((visibleMask & (1 << lane)) != 0 && ids[lane] == id) quadMask |= 1 << lane;
+			}
+			visibleMask &= ~quadMask;
+
+			ShadeQuad<output>(frameBuffer, *pTriangleTable[id], qx, qy, quadMask, batch);
+		}
+	}
+
+	if constexpr (output == PixelOutput::Color)
+		ShadeBatch<output>(frameBuffer, batch);
+}
+
+template<Mesh::PixelOutput output>
+void Mesh::ShadeBatch(const FrameBuffer& frameBuffer, PixelBatch& batch) const
+{
+	if (batch.numQuads == 0)
+		return;
+
+	//1. Pixel shader, the discarded lanes drop out of the mask
+	ColorRGB colors[PixelLanes::size];
+	alignas(16) float alphas[PixelLanes::size];
+	std::fill_n(alphas, PixelLanes::size, 1.f);
+	const int pixelMask{ m_PixelShader(batch.lanes, batch.pixelMask, colors, alphas) };
+
+	//2. Write the pixels that are left: blended a quad at a time, accumulated or overwritten
+	if constexpr (output == PixelOutput::Blend)
+	{
+		for (int quad{}; quad < batch.numQuads; ++quad)
+		{
+			const int quadMask{ (pixelMask >> (quad * PixelLanes::quadSize)) & 0xF };
+			if (quadMask != 0)
+				BlendQuad(frameBuffer, batch.quadIndices[quad], quadMask, colors + quad * PixelLanes::quadSize, alphas + quad * PixelLanes::quadSize);
+		}
+	}
+	else
+	{
+		for (int lane{}, mask{ pixelMask }; mask != 0; ++lane, mask >>= 1)
+		{
+			if ((mask & 1) == 0) continue;
+
+			const int quadLane{ lane % PixelLanes::quadSize };
+			const int pixelIndex{ batch.quadIndices[lane / PixelLanes::quadSize] + (quadLane & 1) + ((quadLane >> 1) * frameBuffer.width) };
+			if constexpr (output == PixelOutput::Accumulate)
+				AccumulatePixel(frameBuffer, pixelIndex, colors[lane], alphas[lane], batch.viewDepths[lane]);
+			else
+				WritePixel(frameBuffer, pixelIndex, colors[lane]);
+		}
+	}
+
+	batch.numQuads = 0;
+	batch.pixelMask = 0;
+}
+
+void Mesh::BlendQuad(const FrameBuffer& frameBuffer, int quadIndex, int quadMask, const ColorRGB* pColors, const float* pAlphas) const
+{
+	// Variables
+	const int width{ frameBuffer.width };
+
+#if defined(DAE_SIMD_X64)
+	//Quads that lie completely inside the framebuffer blend all four lanes at once, the pixels outside quadMask are written back unchanged
+	if (quadIndex % width + 1 < width && quadIndex / width + 1 < frameBuffer.height)
+	{
+		uint32_t* pRow0{ frameBuffer.pPixels + quadIndex };
+		uint32_t* pRow1{ pRow0 + width };
+
+		const __m128 one{ _mm_set1_ps(1.f) };
+		const __m128 maxByte{ _mm_set1_ps(255.f) };
+		const __m128i byteMask{ _mm_set1_epi32(0xFF) };
+		const __m128i redShift{ _mm_cvtsi32_si128(frameBuffer.redShift) };
+		const __m128i greenShift{ _mm_cvtsi32_si128(frameBuffer.greenShift) };
+		const __m128i blueShift{ _mm_cvtsi32_si128(frameBuffer.blueShift) };
+
+		//1. Destination, back to [0, 1]
+		const __m128i destination{ _mm_castps_si128(LoadQuad(reinterpret_cast<const float*>(pRow0), reinterpret_cast<const float*>(pRow1))) };
+		const __m128 destinationR{ _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(destination, redShift), byteMask)), maxByte) };
+		const __m128 destinationG{ _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(destination, greenShift), byteMask)), maxByte) };
+		const __m128 destinationB{ _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(destination, blueShift), byteMask)), maxByte) };
+
+		//2. Source, scaled back to one like WritePixel does
+		__m128 sourceR{ _mm_setr_ps(pColors[0].r, pColors[1].r, pColors[2].r, pColors[3].r) };
+		__m128 sourceG{ _mm_setr_ps(pColors[0].g, pColors[1].g, pColors[2].g, pColors[3].g) };
+		__m128 sourceB{ _mm_setr_ps(pColors[0].b, pColors[1].b, pColors[2].b, pColors[3].b) };
+		const __m128 maxValue{ _mm_max_ps(_mm_max_ps(sourceR, _mm_max_ps(sourceG, sourceB)), one) };
+		sourceR = _mm_div_ps(sourceR, maxValue);
+		sourceG = _mm_div_ps(sourceG, maxValue);
+		sourceB = _mm_div_ps(sourceB, maxValue);
+
+		//3. Source over destination
+		const __m128 alpha{ _mm_loadu_ps(pAlphas) };
+		const __m128 inverseAlpha{ _mm_sub_ps(one, alpha) };
+		const __m128i r{ _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(sourceR, alpha), _mm_mul_ps(destinationR, inverseAlpha)), maxByte)) };
+		const __m128i g{ _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(sourceG, alpha), _mm_mul_ps(destinationG, inverseAlpha)), maxByte)) };
+		const __m128i b{ _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(sourceB, alpha), _mm_mul_ps(destinationB, inverseAlpha)), maxByte)) };
+		const __m128i blended{ _mm_or_si128(_mm_or_si128(_mm_sll_epi32(r, redShift), _mm_sll_epi32(g, greenShift)), _mm_sll_epi32(b, blueShift)) };
+
+		//4. Write back, only the lanes in the mask change
+		const __m128i laneBits{ _mm_setr_epi32(1, 2, 4, 8) };
+		const __m128i laneMask{ _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(quadMask), laneBits), laneBits) };
+		const __m128i result{ _mm_or_si128(_mm_and_si128(laneMask, blended), _mm_andnot_si128(laneMask, destination)) };
+		StoreQuad(reinterpret_cast<float*>(pRow0), reinterpret_cast<float*>(pRow1), _mm_castsi128_ps(result));
+		return;
+	}
+#endif
+
+	for (int lane{}; quadMask != 0; ++lane, quadMask >>= 1)
+	{
+		if ((quadMask & 1) == 0) continue;
+
+		BlendPixel(frameBuffer, quadIndex + (lane & 1) + ((lane >> 1) * width), pColors[lane], pAlphas[lane]);
+	}
+}
+
+float Mesh::InterpolateAttributes(const TriangleSetup& triangle, int px, int py, PixelLanes& lanes, int lane) const
+{
+	// Variables
+	const float x{ static_cast<float>(px) };
+	const float y{ static_cast<float>(py) };
+
+	//Depth correction
+	const float correction{ 1.f / triangle.invW.Evaluate(x, y) };
+
+	lanes.uvX[lane] = triangle.uvX.Evaluate(x, y) * correction;
+	lanes.uvY[lane] = triangle.uvY.Evaluate(x, y) * correction;
+	lanes.normalX[lane] = triangle.normalX.Evaluate(x, y) * correction;
+	lanes.normalY[lane] = triangle.normalY.Evaluate(x, y) * correction;
+	lanes.normalZ[lane] = triangle.normalZ.Evaluate(x, y) * correction;
+	lanes.tangentX[lane] = triangle.tangentX.Evaluate(x, y) * correction;
+	lanes.tangentY[lane] = triangle.tangentY.Evaluate(x, y) * correction;
+	lanes.tangentZ[lane] = triangle.tangentZ.Evaluate(x, y) * correction;
+	lanes.worldX[lane] = triangle.worldX.Evaluate(x, y);
+	lanes.worldY[lane] = triangle.worldY.Evaluate(x, y);
+	lanes.worldZ[lane] = triangle.worldZ.Evaluate(x, y);
+
+	//1 / (1 / w) is the view depth of the pixel
+	return correction;
+}
+
+ColorRGB Mesh::DepthToColor(float depthBuffer) const
+{
+	//Remap the depthbuffer to avoid having everything in white
+	Remap(depthBuffer, 0.995f, 1.f);
+
+	//Clamp the depthbuffer to prevent negative values
+	depthBuffer = Clamp(depthBuffer, 0.f, 1.f);
+
+	return { depthBuffer,depthBuffer,depthBuffer };
+}
+
+void Mesh::WritePixel(const FrameBuffer& frameBuffer, int pixelIndex, ColorRGB color) const
+{
+	color.MaxToOne();
+
+	frameBuffer.pPixels[pixelIndex] = frameBuffer.MapRGB(
+		static_cast<uint8_t>(color.r * 255),
+		static_cast<uint8_t>(color.g * 255),
+		static_cast<uint8_t>(color.b * 255));
+}
+
+void Mesh::BlendPixel(const FrameBuffer& frameBuffer, int pixelIndex, ColorRGB color, float alpha) const
+{
+	//Destination back to [0, 1]
+	const uint32_t pixel{ frameBuffer.pPixels[pixelIndex] };
+	const ColorRGB destination{
+		((pixel >> frameBuffer.redShift) & 0xFF) / 255.f,
+		((pixel >> frameBuffer.greenShift) & 0xFF) / 255.f,
+		((pixel >> frameBuffer.blueShift) & 0xFF) / 255.f };
+
+	//Source over destination
+	color.MaxToOne();
+	WritePixel(frameBuffer, pixelIndex, color * alpha + destination * (1.f - alpha));
+}
+
+void Mesh::AccumulatePixel(const FrameBuffer& frameBuffer, int pixelIndex, ColorRGB color, float alpha, float viewDepth) const
+{
+	//1. Weight: nearer fragments dominate the average, so the result still looks ordered (McGuire and Bavoil, equation 9)
+	const float nearFactor{ viewDepth / 5.f };
+	const float farFactor{ viewDepth / 200.f };
+	const float farFactor3{ farFactor * farFactor * farFactor };
+	const float weight{ alpha * Clamp(10.f / (1e-5f + nearFactor * nearFactor + farFactor3 * farFactor3), 1e-2f, 3e3f) };
+
+	//2. Weighted premultiplied color + coverage, the order of the additions does not matter
+	color.MaxToOne();
+
+	float* pAccumulation{ frameBuffer.pAccumulation + static_cast<size_t>(pixelIndex) * 4 };
+	pAccumulation[0] += color.r * alpha * weight;
+	pAccumulation[1] += color.g * alpha * weight;
+	pAccumulation[2] += color.b * alpha * weight;
+	pAccumulation[3] += alpha * weight;
+
+	//3. What is left of the background
+	frameBuffer.pRevealage[pixelIndex] *= 1.f - alpha;
+}
+
+Vector4 Mesh::ClipToRaster(const Vector4& position, int width, int heigth) const
+{
+	//Perspective divide, w is kept for perspective correct interpolation
+	Vector4 temp{ position };
+	temp.x = position.x / position.w;
+	temp.y = position.y / position.w;
+	temp.z = position.z / position.w;
+
+	//NDC to Raster Space
+	temp.x = ((1.f + temp.x) / 2.f) * width;
+	temp.y = ((1.f - temp.y) / 2.f) * heigth;
+	return temp;
+}
+
+Vertex_Out Mesh::LerpVertex(const Vertex_Out& a, const Vertex_Out& b, float t) const
+{
+	//Clip space is not yet divided by w, so every attribute is interpolated linearly
+	Vertex_Out temp{};
+	temp.position = a.position + (b.position - a.position) * t;
+	temp.uv = a.uv + (b.uv - a.uv) * t;
+	if (m_pMaterial->HasSurfaceAttributes())
+	{
+		temp.normal = a.normal + (b.normal - a.normal) * t;
+		temp.tangent = a.tangent + (b.tangent - a.tangent) * t;
+		temp.worldPosition = a.worldPosition + (b.worldPosition - a.worldPosition) * t;
+	}
+	return temp;
+}
+
+bool Mesh::FrustumCulling(const Vector4& v0, const Vector4& v1, const Vector4& v2) const
+{
+	//Clip space: a triangle is only culled when all of its vertices are outside the same plane
+	if (v0.x < -v0.w && v1.x < -v1.w && v2.x < -v2.w) return true;
+	if (v0.x > v0.w && v1.x > v1.w && v2.x > v2.w) return true;
+	if (v0.y < -v0.w && v1.y < -v1.w && v2.y < -v2.w) return true;
+	if (v0.y > v0.w && v1.y > v1.w && v2.y > v2.w) return true;
+	if (v0.z < 0.f && v1.z < 0.f && v2.z < 0.f) return true;
+	if (v0.z > v0.w && v1.z > v1.w && v2.z > v2.w) return true;
+
+	return false;
+}
+
+bool Mesh::NeedsClipping(const Vector4& v0, const Vector4& v1, const Vector4& v2) const
+{
+	//Crossing the near plane
+	if (v0.z < 0.f || v1.z < 0.f || v2.z < 0.f) return true;
+
+	//Leaving the guard band, the rasterizer itself only clamps the bounding box to the screen
+	for (const Vector4* pV : { &v0, &v1, &v2 })
+	{
+		const float guardBand{ m_GuardBand * pV->w };
+		if (pV->x < -guardBand || pV->x > guardBand || pV->y < -guardBand || pV->y > guardBand) return true;
+	}
 
 	return false;
 }
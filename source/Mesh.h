@@ -1,19 +1,26 @@
 #pragma once
 // Includes
 #include "DataTypes.h"
+#include "SIMD.h"
+#include "HiZBuffer.h"
+#include "FrameArena.h"
+#include "Material.h"
 
 namespace dae
 {
 	// Class Forward Declarations
-	class Material;
 	class Texture;
+	class ThreadPool;
 	
 	// Class Declaration
 	class Mesh final
 	{
 	public:
 		// Constructors and Destructor
-		explicit Mesh(ID3D11Device* pDevice, SDL_Surface* pBackBuffer, const std::string& filename, Material* pMaterial);
+		explicit Mesh(const std::string& filename, Material* pMaterial);
+#if !defined(HEADLESS)
+		explicit Mesh(ID3D11Device* pDevice, const std::string& filename, Material* pMaterial);
+#endif
 		~Mesh();
 		
 		// Copy and Move semantics
@@ -25,11 +32,22 @@ namespace dae
 		//---------------------------
 		// Public Member Functions
 		//---------------------------
+#if !defined(HEADLESS)
 		void RenderHardware(ID3D11DeviceContext* pDeviceContext) const;
-		void RenderSoftware(SDL_Surface* pBackBuffer) const;
+#endif
+		//Not const: the draw writes the visible triangles, the stats and the selected pixel shader of this mesh, one draw at a time
+		void RenderSoftware(const FrameBuffer& frameBuffer, ThreadPool& threadPool, FrameArena& frameArena, const Vector3& cameraPosition);
+		//Composites what the weighted blended draws of this frame accumulated over the target, once after the last of them
+		static void ResolveWeightedBlended(const FrameBuffer& frameBuffer, ThreadPool& threadPool);
 
 		bool ToggleDepthBuffer();
 		bool ToggleBoundingBox();
+		bool ToggleFixedPoint();
+		bool ToggleDeferred();
+		bool ToggleLazyVertexShading();
+		bool ToggleWeightedBlended();
+		void SetCullMode(CullMode cullMode) { m_CullMode = cullMode; }
+		void SetTransparent(bool isTransparent) { m_IsTransparent = isTransparent; }
 
 		void Translate(const Vector3& translation);
 		void Rotate(const Vector3& rotation);
@@ -40,6 +58,8 @@ namespace dae
 		void SetScale(const Vector3& scale);
 
 		Material* GetMaterial() const { return m_pMaterial; }
+		bool IsWeightedBlended() const { return m_IsTransparent && m_IsWeightedBlended; }
+		const PipelineStats& GetStats() const { return m_Stats; }
 		Matrix GetWorldMatrix() const { return Matrix::CreateTransform(m_Position, m_Rotation, m_Scale); }
 
 	
@@ -57,21 +77,140 @@ namespace dae
 		ID3D11Buffer* m_pIndexBuffer{};
 
 		//SOFTWARE
-		uint32_t* m_pBackBufferPixels{};
-		float* m_pDepthBufferPixels{};
 		std::vector<Vertex> m_Vertices{};
 		std::vector<uint32_t> m_Indices{};
+		std::vector<Vector3> m_FaceNormals{}; //Object space, not normalized, front faces see the camera on their positive side
 
 		bool m_IsShowDepthBuffer{ false };
 		bool m_IsShowBoundingBox{ false };
+		bool m_IsFixedPoint{ true };
+		bool m_IsDeferred{ false };
+		bool m_IsLazyVertexShading{ true };
+		CullMode m_CullMode{ CullMode::Back };
+		bool m_IsTransparent{ false }; //Alpha blended back to front, depth tested but never written (like the hardware FireFX)
+		bool m_IsWeightedBlended{ false }; //Transparent without sorting: weighted blended order independent transparency
+
+		std::vector<uint32_t> m_VisibleTriangles{};
+		std::vector<uint8_t> m_IsVertexUsed{};
+
+		//Lazy vertex shading: per frame, per group of consecutive vertices, so every vertex gets its attributes shaded at most once
+		//A group is shaded as a whole (one SIMD batch), the vertices of neighbouring triangles mostly lie close together
+		enum class VertexState : uint8_t
+		{
+			Unshaded,
+			Shading,
+			Shaded
+		};
+		static constexpr uint32_t m_VertexGroupSize{ 16 };
+		static constexpr int m_MaxVertexSpins{ 64 }; //Waits on a group this long, then yields (the shading thread may be descheduled)
+
+		//Sort-middle pipeline: triangles are set up once, binned per screen tile, tiles rasterize in parallel
+		static constexpr int m_TileSize{ HiZBuffer::tileSize };
+		static constexpr uint32_t m_ChunksPerThread{ 4 };
+		static constexpr int m_BlockSize{ HiZBuffer::blockSize };
+
+		//Clipping: triangles only get clipped when they cross the near plane or leave the guard band (in NDC units)
+		static constexpr float m_GuardBand{ 16.f };
+		static constexpr int m_MaxClipVertices{ 9 };
+		static_assert(m_TileSize % m_BlockSize == 0 && m_BlockSize % PixelLanes::size == 0, "Pixel blocks must not cross tiles");
+
+		PipelineStats m_Stats{};
+
+		//Per draw specialization: the debug views, deferred shading, fixed point and the SIMD level are template arguments of the kernels,
+		//RenderSoftware picks the variant once from a table instead of every pixel checking the flags
+		enum class PixelOutput
+		{
+			Color, //Forward shading
+			Depth, //Depth buffer view
+			Visibility, //Triangle ids for deferred shading
+			Blend, //Transparent forward shading, blended over the target without writing depth
+			Accumulate, //Transparent forward shading into the weighted blended buffers, without writing depth
+
+			//@END
+			END
+		};
+
+		enum class PixelKernel
+		{
+			Float,
+			Fixed,
+			FixedSSE2,
+			FixedAVX2,
+
+			//@END
+			END
+		};
+
+		//Outputs that run the pixel shader on the spot, and the ones that write depth
+		static constexpr bool IsShaded(PixelOutput output) { return output == PixelOutput::Color || output == PixelOutput::Blend || output == PixelOutput::Accumulate; }
+		static constexpr bool IsDepthWritten(PixelOutput output) { return output != PixelOutput::Blend && output != PixelOutput::Accumulate; }
+
+		using RenderTriangleFunction = void (Mesh::*)(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& tileMin, const Int2& tileMax, PipelineStats& stats) const;
+		static const RenderTriangleFunction m_RenderTriangleFunctions[static_cast<int>(PixelOutput::END)][static_cast<int>(PixelKernel::END)]; //[PixelOutput][PixelKernel]
+
+		Material::PixelShader m_PixelShader{}; //Current draw only
+
+		//Quads with at least one pixel that passed the depth test, shaded together once the batch is full
+		struct PixelBatch
+		{
+			PixelLanes lanes{};
+			int quadIndices[PixelLanes::numQuads]{}; //Pixel index of the top-left pixel
+			alignas(32) float viewDepths[PixelLanes::size]{}; //Accumulate only, for the weights (the perspective correction of the lanes)
+			int pixelMask{};
+			int numQuads{};
+		};
 	
 		//---------------------------
 		// Private Member Functions
 		//---------------------------
-		void RenderTriangle(SDL_Surface* pBackBuffer, const Vertex_Out& v0, const Vertex_Out& v1, const Vertex_Out& v2) const;
+		void CullTriangles(const Vector3& cameraPosition);
+		void SortBackToFront(const VertexStreams& vertices, FrameArena& frameArena);
+		void AssembleTriangle(const FrameBuffer& frameBuffer, const VertexStreams& vertices, VertexState* pVertexStates, uint32_t i0, uint32_t i1, uint32_t i2, FrameVector<TriangleSetup>& triangles) const;
+		Vertex_Out FetchVertex(const VertexStreams& vertices, VertexState* pVertexStates, uint32_t index) const;
+		int ClipPolygon(Vertex_Out* pPolygon, int numVertices) const;
+		bool SetupTriangle(const FrameBuffer& frameBuffer, Vector4* pPositions, uint32_t* pCorners, TriangleSetup& triangle) const;
+		bool SetupAttributePlanes(const Vertex_Out* const* pVertices, const Vector4* pPositions, TriangleSetup& triangle) const;
+		bool SetupEdgesFloat(const FrameBuffer& frameBuffer, TriangleSetup& triangle) const;
+		bool SetupEdgesFixed(const FrameBuffer& frameBuffer, TriangleSetup& triangle) const;
+
+		RenderTriangleFunction SelectRenderTriangle() const;
+		void RenderBoundingBox(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& tileMin, const Int2& tileMax, PipelineStats& stats) const;
+		template<PixelOutput output, PixelKernel kernel>
+		void RenderTriangle(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& tileMin, const Int2& tileMax, PipelineStats& stats) const;
+		template<PixelOutput output>
+		void RenderPixelsFloat(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max) const;
+		template<PixelOutput output, PixelKernel kernel>
+		void RenderBlocksFixed(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max, PipelineStats& stats) const;
+		template<PixelOutput output, PixelKernel kernel>
+		void RenderPixelsFixedKernel(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max, bool isCovered) const;
+		template<PixelOutput output>
+		void RenderPixelsFixed(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max, bool isCovered) const;
+#if defined(DAE_SIMD_X64)
+		template<PixelOutput output>
+		void RenderPixelsFixedSSE2(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max, bool isCovered) const;
+		template<PixelOutput output>
+		void RenderPixelsFixedAVX2(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, const Int2& min, const Int2& max, bool isCovered) const;
+#endif
+		bool DepthTest(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, int px, int py, bool isDepthWrite) const;
+		template<PixelOutput output>
+		void ShadeQuad(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, int qx, int qy, int quadMask, PixelBatch& batch) const;
+		template<PixelOutput output>
+		void EmitQuad(const FrameBuffer& frameBuffer, const TriangleSetup& triangle, int qx, int qy, int quadMask, PixelBatch& batch) const;
+		template<PixelOutput output>
+		void ShadeVisibleQuads(const FrameBuffer& frameBuffer, const TriangleSetup* const* pTriangleTable, int qy) const;
+		template<PixelOutput output>
+		void ShadeBatch(const FrameBuffer& frameBuffer, PixelBatch& batch) const;
+		void BlendQuad(const FrameBuffer& frameBuffer, int quadIndex, int quadMask, const ColorRGB* pColors, const float* pAlphas) const;
+		float InterpolateAttributes(const TriangleSetup& triangle, int px, int py, PixelLanes& lanes, int lane) const;
+		ColorRGB DepthToColor(float depthBuffer) const;
+		void WritePixel(const FrameBuffer& frameBuffer, int pixelIndex, ColorRGB color) const;
+		void BlendPixel(const FrameBuffer& frameBuffer, int pixelIndex, ColorRGB color, float alpha) const;
+		void AccumulatePixel(const FrameBuffer& frameBuffer, int pixelIndex, ColorRGB color, float alpha, float viewDepth) const;
 
-		Vertex_Out NDCToRaster(const Vertex_Out& v, int width, int heigth) const;
-		bool FrustumCulling(const Vector4& v) const;
+		Vector4 ClipToRaster(const Vector4& position, int width, int heigth) const;
+		Vertex_Out LerpVertex(const Vertex_Out& a, const Vertex_Out& b, float t) const;
+		bool FrustumCulling(const Vector4& v0, const Vector4& v1, const Vector4& v2) const;
+		bool NeedsClipping(const Vector4& v0, const Vector4& v1, const Vector4& v2) const;
 		bool Remap(float& value, float min, float max) const;
 	
 	};
@@ -2,6 +2,11 @@
 #include "Renderer.h"
 #include "Utils.h"
 #include "Scene.h"
+#include "ThreadPool.h"
+#include "HiZBuffer.h"
+#include "FrameArena.h"
+#include "AllocationCounter.h"
+#include <cassert>
 
 namespace dae {
 
@@ -29,13 +34,21 @@ namespace dae {
 		}
 
 		//Initialize Scene
-		m_pScene = new Scene(m_pDevice, m_pBackBuffer);
+		m_pScene = new Scene(m_pDevice, m_FrameBuffer);
 		
 	}
 
 	Renderer::~Renderer()
 	{
 		if (m_pScene) delete m_pScene;
+		if (m_pThreadPool) delete m_pThreadPool;
+		delete m_pFrameArena;
+
+		delete[] m_pRevealage;
+		delete[] m_pAccumulation;
+		delete[] m_pTriangleIds;
+		delete m_pHiZBuffer;
+		delete[] m_pDepthBufferPixels;
 
 		if (m_pRenderTargetView) m_pRenderTargetView->Release();
 		if (m_pRenderTargetBuffer) m_pRenderTargetBuffer->Release();
@@ -68,6 +81,15 @@ namespace dae {
 
 				m_PrintTimer = m_PrintInterval;
 				std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+
+				if (m_RasterizerMode == RasterizerMode::software)
+				{
+					const PipelineStats& stats = m_pScene->GetSoftwareStats();
+					std::cout << "\tVertices: " << stats.numVertices << ", shaded " << stats.numShadedVertices << "\n";
+					std::cout << "\tTriangles: " << stats.numTriangles << ", culled " << stats.numCulled << ", set up " << stats.numSetUp << "\n";
+					std::cout << "\tHi-Z rejected: " << stats.numHiZTriangles << " / " << stats.numBinned << " binned triangles, " << stats.numHiZBlocks << " blocks\n";
+					std::cout << "\tHeap allocations: " << m_NumFrameAllocations << std::endl;
+				}
 			}
 		}
 	}
@@ -97,23 +119,23 @@ namespace dae {
 		std::cout << "[Key Bindings - SHARED]\n";
 		std::cout << "\t[F1] Toggle Rasterizer Mode(HARDWARE / SOFTWARE)\n";
 		std::cout << "\t[F2]  Toggle Vehicle Rotation(ON / OFF)\n";
+		std::cout << "\t[F3]  Toggle FireFX(ON / OFF)\n";
+		std::cout << "\t[F4]  Cycle Sampler State(POINT / LINEAR / ANISOTROPIC)\n";
 		std::cout << "\t[F9]  Cycle CullMode(BACK / FRONT / NONE)\n";
 		std::cout << "\t[F10] Toggle Uniform ClearColor(ON / OFF)\n";
 		std::cout << "\t[F11] Toggle Print FPS(ON / OFF)\n";
 		std::cout << "\n";
 
-		SetConsoleTextAttribute(hConsole, m_AttributeHardware);
-		std::cout << "[Key Bindings - HARDWARE]\n";
-		std::cout << "\t[F3] Toggle FireFX(ON / OFF)\n";
-		std::cout << "\t[F4] Cycle Sampler State(POINT / LINEAR / ANISOTROPIC)\n";
-		std::cout << "\n";
-
 		SetConsoleTextAttribute(hConsole, m_AttributeSoftware);
 		std::cout << "[Key Bindings - SOFTWARE]\n";
 		std::cout << "\t[F5] Cycle Shading Mode(COMBINED / OBSERVED_AREA / DIFFUSE / SPECULAR)\n";
 		std::cout << "\t[F6] Toggle NormalMap(ON / OFF)\n";
 		std::cout << "\t[F7] Toggle DepthBuffer Visualization(ON / OFF)\n";
 		std::cout << "\t[F8] Toggle BoundingBox Visualization(ON / OFF)\n";
+		std::cout << "\t[F12] Toggle Edge Precision(FIXED POINT / FLOAT)\n";
+		std::cout << "\t[V]   Toggle Shading(FORWARD / DEFERRED)\n";
+		std::cout << "\t[L]   Toggle Vertex Shading(LAZY / EAGER)\n";
+		std::cout << "\t[O]   Toggle Transparency(SORTED / WEIGHTED_BLENDED)\n";
 	}
 
 #pragma region SHARED
@@ -138,14 +160,30 @@ namespace dae {
 		std::cout << "**(SHARED) Vehicle Rotation " << s << std::endl;
 	}
 
+	void Renderer::ToggleFireFX()
+	{
+		bool isFire = m_pScene->ToggleFireFX();
+
+		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+		SetConsoleTextAttribute(hConsole, m_AttributeShared);
+		std::string s = (isFire) ? "ON" : "OFF";
+		std::cout << "**(SHARED) FireFX " << s << std::endl;
+	}
+
 	void Renderer::CycleCullMode()
 	{
-		//TODO: implement function
-		bool cullmode = true;
+		m_CullMode = CullMode(((int)m_CullMode + 1) % (int)CullMode::END);
+		m_pScene->SetCullMode(m_CullMode);
 
 		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 		SetConsoleTextAttribute(hConsole, m_AttributeShared);
-		std::string s = "NONE";
+		std::string s{};
+		switch (m_CullMode)
+		{
+		case CullMode::Back:	s = "BACK";		break;
+		case CullMode::Front:	s = "FRONT";	break;
+		case CullMode::None:	s = "NONE";		break;
+		}
 		std::cout << "**(SHARED) CullMode = " << s << std::endl;
 	}
 
@@ -168,34 +206,18 @@ namespace dae {
 		std::string s = (m_IsPrintFPS) ? "ON" : "OFF";
 		std::cout << "**(SHARED) Print FPS " << s << std::endl;
 	}
-#pragma endregion
-
-#pragma region HARDWARE
-	// Public
-	void Renderer::ToggleFireFX()
-	{
-		if (m_RasterizerMode != RasterizerMode::hardware) return;
-
-		bool isFire = m_pScene->ToggleFireFX();
-
-		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-		SetConsoleTextAttribute(hConsole, m_AttributeHardware);
-		std::string s = (isFire) ? "ON" : "OFF";
-		std::cout << "**(HARDWARE) FireFX " << s << std::endl;
-	}
 
 	void Renderer::CycleSamplerState()
 	{
-		if (m_RasterizerMode != RasterizerMode::hardware) return;
+		std::string s = m_pScene->CycleSamplerState();
 
 		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-		SetConsoleTextAttribute(hConsole, m_AttributeHardware);
-
-		std::string s = m_pScene->CycleSamplerState();
-		std::cout << "**(HARDWARE) Sampler Filter = " << s << std::endl;
+		SetConsoleTextAttribute(hConsole, m_AttributeShared);
+		std::cout << "**(SHARED) Sampler Filter = " << s << std::endl;
 	}
+#pragma endregion
 
-
+#pragma region HARDWARE
 	// Private
 	void Renderer::RenderHardware() const
 	{
@@ -391,10 +413,62 @@ namespace dae {
 		std::cout << "**(SOFTWARE) BoundingBox Visualization " << s << std::endl;
 	}
 
+	void Renderer::ToggleFixedPoint()
+	{
+		if (m_RasterizerMode != RasterizerMode::software) return;
+
+		bool isFixedPoint = m_pScene->ToggleFixedPoint();
+
+		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+		SetConsoleTextAttribute(hConsole, m_AttributeSoftware);
+		std::string s = (isFixedPoint) ? "FIXED POINT" : "FLOAT";
+		std::cout << "**(SOFTWARE) Edge Precision " << s << std::endl;
+	}
+
+	void Renderer::ToggleDeferred()
+	{
+		if (m_RasterizerMode != RasterizerMode::software) return;
+
+		bool isDeferred = m_pScene->ToggleDeferred();
+
+		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+		SetConsoleTextAttribute(hConsole, m_AttributeSoftware);
+		std::string s = (isDeferred) ? "DEFERRED" : "FORWARD";
+		std::cout << "**(SOFTWARE) Shading " << s << std::endl;
+	}
+
+	void Renderer::ToggleLazyVertexShading()
+	{
+		if (m_RasterizerMode != RasterizerMode::software) return;
+
+		bool isLazy = m_pScene->ToggleLazyVertexShading();
+
+		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+		SetConsoleTextAttribute(hConsole, m_AttributeSoftware);
+		std::string s = (isLazy) ? "LAZY" : "EAGER";
+		std::cout << "**(SOFTWARE) Vertex Shading " << s << std::endl;
+	}
+
+	void Renderer::ToggleWeightedBlended()
+	{
+		if (m_RasterizerMode != RasterizerMode::software) return;
+
+		bool isWeightedBlended = m_pScene->ToggleWeightedBlended();
+
+		HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+		SetConsoleTextAttribute(hConsole, m_AttributeSoftware);
+		std::string s = (isWeightedBlended) ? "WEIGHTED_BLENDED" : "SORTED";
+		std::cout << "**(SOFTWARE) Transparency " << s << std::endl;
+	}
+
 
 	// Private
 	void Renderer::RenderSoftware() const
 	{
+		//0. Start of the frame: transient memory of the last frame is given back
+		m_pFrameArena->Reset();
+		const uint64_t numAllocations{ AllocationCounter::GetCount() };
+
 		//1. Lock BackBuffer
 		SDL_LockSurface(m_pBackBuffer);
 
@@ -406,10 +480,19 @@ namespace dae {
 			static_cast<uint8_t>(clearColor.g * 255),
 			static_cast<uint8_t>(clearColor.b * 255)));
 
-		//3. Render Scene
-		m_pScene->RenderSoftware(m_pBackBuffer);
+		//3. Clear DepthBuffer
+		std::fill_n(m_FrameBuffer.pDepthPixels, m_FrameBuffer.width * m_FrameBuffer.height, FLT_MAX);
+		m_FrameBuffer.pHiZBuffer->Clear(FLT_MAX);
+
+		//4. Render Scene
+		m_pScene->RenderSoftware(m_FrameBuffer, *m_pThreadPool, *m_pFrameArena);
 
-		//4. Update SDL Surface
+		//Once warmed up, frames that fit in the arena must not allocate
+		m_NumFrameAllocations = AllocationCounter::GetCount() - numAllocations;
+		[[maybe_unused]] const bool isFirstFrame{ m_NumFrames++ == 0 };
+		assert((isFirstFrame || m_pFrameArena->HasOverflowed() || m_NumFrameAllocations == 0) && "Heap allocation in a steady state frame");
+
+		//5. Update SDL Surface
 		SDL_UnlockSurface(m_pBackBuffer);
 		SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
 		SDL_UpdateWindowSurface(m_pWindow);
@@ -420,6 +503,37 @@ namespace dae {
 		//Create Buffers
 		m_pFrontBuffer = SDL_GetWindowSurface(m_pWindow);
 		m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
+
+		//Describe the BackBuffer for the software pipeline
+		m_FrameBuffer.pPixels = (uint32_t*)m_pBackBuffer->pixels;
+		m_FrameBuffer.width = m_pBackBuffer->w;
+		m_FrameBuffer.height = m_pBackBuffer->h;
+		m_FrameBuffer.redShift = m_pBackBuffer->format->Rshift;
+		m_FrameBuffer.greenShift = m_pBackBuffer->format->Gshift;
+		m_FrameBuffer.blueShift = m_pBackBuffer->format->Bshift;
+
+		//Create DepthBuffer + Visibility Buffer, shared by every mesh
+		m_pDepthBufferPixels = new float[m_Width * m_Height];
+		m_pHiZBuffer = new HiZBuffer(m_Width, m_Height);
+		m_pTriangleIds = new uint32_t[m_Width * m_Height];
+		std::fill_n(m_pTriangleIds, m_Width * m_Height, FrameBuffer::noTriangle);
+
+		m_FrameBuffer.pDepthPixels = m_pDepthBufferPixels;
+		m_FrameBuffer.pHiZBuffer = m_pHiZBuffer;
+		m_FrameBuffer.pTriangleIds = m_pTriangleIds;
+
+		//Create Weighted Blended Transparency Buffers
+		m_pAccumulation = new float[m_Width * m_Height * 4];
+		m_pRevealage = new float[m_Width * m_Height];
+		std::fill_n(m_pAccumulation, m_Width * m_Height * 4, 0.f);
+		std::fill_n(m_pRevealage, m_Width * m_Height, 1.f);
+
+		m_FrameBuffer.pAccumulation = m_pAccumulation;
+		m_FrameBuffer.pRevealage = m_pRevealage;
+
+		//Create Workers (one thread per core) + their per frame memory
+		m_pThreadPool = new ThreadPool();
+		m_pFrameArena = new FrameArena(m_FrameArenaCapacity);
 	}
 #pragma endregion
 
@@ -1,4 +1,5 @@
 #pragma once
+#include "DataTypes.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -6,6 +7,8 @@ struct SDL_Surface;
 namespace dae
 {
 	class Scene;
+	class ThreadPool;
+	class FrameArena;
 
 	class Renderer final
 	{
@@ -25,12 +28,10 @@ namespace dae
 		//SHARED
 		void ToggleRasterizerMode();
 		void ToggleRotation();
+		void ToggleFireFX();
 		void CycleCullMode();
 		void ToggleUniformClearColor();
 		void TogglePrintFPS();
-
-		//HARDWARE
-		void ToggleFireFX();
 		void CycleSamplerState();
 
 		//SOFTWARE
@@ -38,6 +39,10 @@ namespace dae
 		void ToggleNormalMap();
 		void ToggleDepthBuffer();
 		void ToggleBoundingBox();
+		void ToggleFixedPoint();
+		void ToggleDeferred();
+		void ToggleLazyVertexShading();
+		void ToggleWeightedBlended();
 
 
 	private:
@@ -47,6 +52,7 @@ namespace dae
 		bool m_IsInitialized{ false };
 		bool m_IsUniformClearColor{ false };
 		bool m_IsPrintFPS{ false };
+		CullMode m_CullMode{ CullMode::Back };
 
 		BYTE m_AttributeFPS{ 8 };
 		BYTE m_AttributeShared{ 6 };
@@ -95,5 +101,18 @@ namespace dae
 
 		SDL_Surface* m_pFrontBuffer{ nullptr };
 		SDL_Surface* m_pBackBuffer{ nullptr };
+		FrameBuffer m_FrameBuffer{};
+		ThreadPool* m_pThreadPool{};
+
+		FrameArena* m_pFrameArena{};
+		const size_t m_FrameArenaCapacity{ 8 * 1024 * 1024 }; //Initial size, grows to fit the largest frame
+		mutable uint64_t m_NumFrameAllocations{};
+		mutable uint32_t m_NumFrames{}; //The first frame fills the arena and may allocate
+
+		float* m_pDepthBufferPixels{};
+		HiZBuffer* m_pHiZBuffer{};
+		uint32_t* m_pTriangleIds{};
+		float* m_pAccumulation{};
+		float* m_pRevealage{};
 	};
 }
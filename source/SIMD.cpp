@@ -0,0 +1,74 @@
+//-----------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------
+#include "pch.h"
+#include "SIMD.h"
+#if defined(DAE_SIMD_X64) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace dae;
+
+
+namespace
+{
+	SIMDLevel g_MaxLevel{ SIMDLevel::avx2 };
+}
+
+
+//-----------------------------------------------------------------
+// Public Functions
+//-----------------------------------------------------------------
+SIMDLevel SIMD::GetLevel()
+{
+	static const SIMDLevel detectedLevel{ DetectLevel() };
+	return std::min(detectedLevel, g_MaxLevel);
+}
+
+SIMDLevel SIMD::DetectLevel()
+{
+#if defined(DAE_SIMD_X64)
+#if defined(_MSC_VER)
+	int info[4]{};
+
+	//1. AVX + FMA support and OS support for the ymm registers (OSXSAVE + XCR0)
+	__cpuid(info, 1);
+	const bool hasFMA{ (info[2] & (1 << 12)) != 0 };
+	const bool hasOSXSave{ (info[2] & (1 << 27)) != 0 };
+	const bool hasAVX{ (info[2] & (1 << 28)) != 0 };
+	if (!hasFMA || !hasOSXSave || !hasAVX) return SIMDLevel::sse2;
+	if ((_xgetbv(0) & 0x6) != 0x6) return SIMDLevel::sse2;
+
+	//2. AVX2
+	__cpuid(info, 0);
+	if (info[0] < 7) return SIMDLevel::sse2;
+
+	__cpuidex(info, 7, 0);
+	if ((info[1] & (1 << 5)) == 0) return SIMDLevel::sse2;
+
+	return SIMDLevel::avx2;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SIMDLevel::avx2;
+
+	return SIMDLevel::sse2;
+#endif
+#else
+	return SIMDLevel::scalar;
+#endif
+}
+
+void SIMD::SetMaxLevel(SIMDLevel maxLevel)
+{
+	g_MaxLevel = maxLevel;
+}
+
+const char* SIMD::ToString(SIMDLevel level)
+{
+	switch (level)
+	{
+	case SIMDLevel::sse2:	return "SSE2";
+	case SIMDLevel::avx2:	return "AVX2";
+	default:				return "SCALAR";
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+// Includes
+#if defined(__x86_64__) || defined(_M_X64)
+#define DAE_SIMD_X64
+#include <immintrin.h>
+#endif
+
+//Functions using AVX2 intrinsics are marked so GCC/Clang generate AVX2 code for them only,
+//the rest of the program keeps running on any x64 cpu (MSVC allows the intrinsics without this)
+#if defined(DAE_SIMD_X64) && (defined(__GNUC__) || defined(__clang__))
+#define DAE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define DAE_TARGET_AVX2
+#endif
+
+namespace dae
+{
+	//Widest instruction set the software rasterizer kernels may use
+	//SSE2 is part of every x64 cpu, AVX2 (+ FMA) is detected at runtime
+	enum class SIMDLevel
+	{
+		scalar,
+		sse2,
+		avx2
+	};
+
+	namespace SIMD
+	{
+		//Level used by the rasterizer: the detected level, unless lowered with SetMaxLevel
+		SIMDLevel GetLevel();
+		SIMDLevel DetectLevel();
+
+		//Lower the level for comparisons/benchmarks, it never goes above what the cpu supports
+		void SetMaxLevel(SIMDLevel maxLevel);
+
+		const char* ToString(SIMDLevel level);
+	}
+}
@@ -15,12 +15,12 @@ using namespace dae;
 //-----------------------------------------------------------------
 // Constructors
 //-----------------------------------------------------------------
-Scene::Scene(ID3D11Device* pDevice, SDL_Surface* pBackBuffer)
+Scene::Scene(ID3D11Device* pDevice, const FrameBuffer& frameBuffer)
 {
-	m_pCamera = new Camera({ 0.f,0.f,0.f }, 45.f, pBackBuffer->w / (float)pBackBuffer->h);
+	m_pCamera = new Camera({ 0.f,0.f,0.f }, 45.f, frameBuffer.width / (float)frameBuffer.height);
 
-	InitVehicle(pDevice, pBackBuffer);
-	InitFireFX(pDevice, pBackBuffer);
+	InitVehicle(pDevice);
+	InitFireFX(pDevice);
 }
 
 
@@ -64,9 +64,10 @@ void Scene::Update(const Timer* pTimer)
 
 	//Update FireFX
 	Matrix fireWorldViewProj = m_pFireFX->GetWorldMatrix() * viewProj;
-	m_pFireFX->GetMaterial()->SetMatrix(worldViewProj, "WorldViewProj");
+	m_pFireFX->GetMaterial()->SetMatrix(fireWorldViewProj, "WorldViewProj");
 }
 
+#if !defined(HEADLESS)
 void Scene::RenderHardware(ID3D11DeviceContext* pDeviceContext) const
 {
 	m_pVehicle->RenderHardware(pDeviceContext);
@@ -74,10 +75,26 @@ void Scene::RenderHardware(ID3D11DeviceContext* pDeviceContext) const
 	if (m_IsShowFireFX)
 		m_pFireFX->RenderHardware(pDeviceContext);
 }
+#endif
 
-void Scene::RenderSoftware(SDL_Surface* pBackBuffer) const
+void Scene::RenderSoftware(const FrameBuffer& frameBuffer, ThreadPool& threadPool, FrameArena& frameArena) const
 {
-	m_pVehicle->RenderSoftware(pBackBuffer);
+	const Vector3 cameraPosition{ m_pCamera->GetInverseViewMatrix().GetTranslation() };
+	m_pVehicle->RenderSoftware(frameBuffer, threadPool, frameArena, cameraPosition);
+
+	//Transparent last, blended over the opaque meshes (weighted blended: accumulated, then resolved in one pass)
+	if (m_IsShowFireFX)
+	{
+		m_pFireFX->RenderSoftware(frameBuffer, threadPool, frameArena, cameraPosition);
+
+		if (m_pFireFX->IsWeightedBlended())
+			Mesh::ResolveWeightedBlended(frameBuffer, threadPool);
+	}
+}
+
+const PipelineStats& Scene::GetSoftwareStats() const
+{
+	return m_pVehicle->GetStats();
 }
 
 bool Scene::ToggleRotation()
@@ -85,6 +102,13 @@ bool Scene::ToggleRotation()
 	return m_IsRotating = !m_IsRotating;
 }
 
+void Scene::SetCullMode(CullMode cullMode)
+{
+	//The FireFX stays double sided
+	m_pVehicle->SetCullMode(cullMode);
+	m_pVehicle->GetMaterial()->SetCullMode(cullMode);
+}
+
 bool Scene::ToggleFireFX()
 {
 	return m_IsShowFireFX = !m_IsShowFireFX;
@@ -114,20 +138,58 @@ bool Scene::ToggleNormalMap()
 
 bool Scene::ToggleDepthBuffer()
 {
+	m_pFireFX->ToggleDepthBuffer();
 	return m_pVehicle->ToggleDepthBuffer();
 }
 
 bool Scene::ToggleBoundingBox()
 {
+	m_pFireFX->ToggleBoundingBox();
 	return m_pVehicle->ToggleBoundingBox();
 }
 
+bool Scene::ToggleFixedPoint()
+{
+	m_pFireFX->ToggleFixedPoint();
+	return m_pVehicle->ToggleFixedPoint();
+}
+
+bool Scene::ToggleDeferred()
+{
+	return m_pVehicle->ToggleDeferred();
+}
+
+bool Scene::ToggleLazyVertexShading()
+{
+	m_pFireFX->ToggleLazyVertexShading();
+	return m_pVehicle->ToggleLazyVertexShading();
+}
+
+bool Scene::ToggleWeightedBlended()
+{
+	return m_pFireFX->ToggleWeightedBlended();
+}
+
 
 //-----------------------------------------------------------------
 // Private Member Functions
 //-----------------------------------------------------------------
-void Scene::InitVehicle(ID3D11Device* pDevice, SDL_Surface* pBackBuffer)
+void Scene::InitVehicle(ID3D11Device* pDevice)
 {
+#if defined(HEADLESS)
+	//1. Create new Material
+	(void)pDevice;
+	MaterialShading* pVehicleMaterial = new MaterialShading();
+
+	//2. Set Textures
+	pVehicleMaterial->SetTexture(new Texture("Resources/vehicle_diffuse.png"), "Diffuse");
+	pVehicleMaterial->SetTexture(new Texture("Resources/vehicle_normal.png"), "Normal");
+	pVehicleMaterial->SetTexture(new Texture("Resources/vehicle_specular.png"), "Specular");
+	pVehicleMaterial->SetTexture(new Texture("Resources/vehicle_gloss.png"), "Gloss");
+
+	//3. Instantiate Mesh
+	m_pVehicle = new Mesh("Resources/vehicle.obj", pVehicleMaterial);
+#else
 	//1. Create new Material
 	MaterialShading* pVehicleMaterial = new MaterialShading(pDevice, L"Resources/Vehicle.fx");
 
@@ -138,12 +200,24 @@ void Scene::InitVehicle(ID3D11Device* pDevice, SDL_Surface* pBackBuffer)
 	pVehicleMaterial->SetTexture(new Texture(pDevice, "Resources/vehicle_gloss.png"), "Gloss");
 
 	//3. Instantiate Mesh
-	m_pVehicle = new Mesh(pDevice, pBackBuffer, "Resources/vehicle.obj", pVehicleMaterial);
+	m_pVehicle = new Mesh(pDevice, "Resources/vehicle.obj", pVehicleMaterial);
+#endif
 	m_pVehicle->SetPosition(0.f, 0.f, 50.f);
 }
 
-void Scene::InitFireFX(ID3D11Device* pDevice, SDL_Surface* pBackBuffer)
+void Scene::InitFireFX(ID3D11Device* pDevice)
 {
+#if defined(HEADLESS)
+	//1. Create new Material
+	(void)pDevice;
+	MaterialTransparency* pVehicleMaterial = new MaterialTransparency();
+
+	//2. Set Textures
+	pVehicleMaterial->SetTexture(new Texture("Resources/fireFX_diffuse.png"), "Diffuse");
+
+	//3. Instantiate Mesh
+	m_pFireFX = new Mesh("Resources/fireFX.obj", pVehicleMaterial);
+#else
 	//1. Create new Material
 	MaterialTransparency* pVehicleMaterial = new MaterialTransparency(pDevice, L"Resources/Fire.fx");
 
@@ -151,7 +225,12 @@ void Scene::InitFireFX(ID3D11Device* pDevice, SDL_Surface* pBackBuffer)
 	pVehicleMaterial->SetTexture(new Texture(pDevice, "Resources/fireFX_diffuse.png"), "Diffuse");
 
 	//3. Instantiate Mesh
-	m_pFireFX = new Mesh(pDevice, pBackBuffer, "Resources/fireFX.obj", pVehicleMaterial);
+	m_pFireFX = new Mesh(pDevice, "Resources/fireFX.obj", pVehicleMaterial);
+#endif
 	m_pFireFX->SetPosition(0.f, 0.f, 50.f);
+
+	//Software state of Fire.fx: double sided, alpha blended, depth tested without writing
+	m_pFireFX->SetCullMode(CullMode::None);
+	m_pFireFX->SetTransparent(true);
 }
 
@@ -1,18 +1,21 @@
 #pragma once
 // Includes
+#include "DataTypes.h"
 
 namespace dae
 {
 	// Class Forward Declarations
 	class Camera;
 	class Mesh;
+	class ThreadPool;
+	class FrameArena;
 	
 	// Class Declaration
 	class Scene final
 	{
 	public:
 		// Constructors and Destructor
-		explicit Scene(ID3D11Device* pDevice, SDL_Surface* pBackBuffer);
+		explicit Scene(ID3D11Device* pDevice, const FrameBuffer& frameBuffer);
 		~Scene();
 		
 		// Copy and Move semantics
@@ -25,14 +28,16 @@ namespace dae
 		// Public Member Functions
 		//---------------------------
 		void Update(const Timer* pTimer);
+#if !defined(HEADLESS)
 		void RenderHardware(ID3D11DeviceContext* pDeviceContext) const;
-		void RenderSoftware(SDL_Surface* pBackBuffer) const;
+#endif
+		void RenderSoftware(const FrameBuffer& frameBuffer, ThreadPool& threadPool, FrameArena& frameArena) const;
+		const PipelineStats& GetSoftwareStats() const;
 
 		//SHARED
 		bool ToggleRotation();
-
-		//HARDWARE
 		bool ToggleFireFX();
+		void SetCullMode(CullMode cullMode);
 		std::string CycleSamplerState();
 
 		//SOFTWARE
@@ -40,6 +45,10 @@ namespace dae
 		bool ToggleNormalMap();
 		bool ToggleDepthBuffer();
 		bool ToggleBoundingBox();
+		bool ToggleFixedPoint();
+		bool ToggleDeferred();
+		bool ToggleLazyVertexShading();
+		bool ToggleWeightedBlended();
 		
 	
 	private:
@@ -54,8 +63,8 @@ namespace dae
 		//---------------------------
 		// Private Member Functions
 		//---------------------------
-		void InitVehicle(ID3D11Device* pDevice, SDL_Surface* pBackBuffer);
-		void InitFireFX(ID3D11Device* pDevice, SDL_Surface* pBackBuffer);
+		void InitVehicle(ID3D11Device* pDevice);
+		void InitFireFX(ID3D11Device* pDevice);
 	
 	};
 }
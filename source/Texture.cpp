@@ -3,29 +3,137 @@
 //-----------------------------------------------------------------
 #include "pch.h"
 #include "Texture.h"
+#include <array>
 #include <cassert>
+#include <bit>
+#include <cmath>
+#include <new>
+
+#if defined(HEADLESS)
+#include <png.h>
+#endif
 
 using namespace dae;
 
+namespace
+{
+	//Byte -> [0, 1], a load per channel instead of a conversion and a multiply (rounded like that multiply)
+	constexpr std::array<float, 256> g_ByteToUnit{ []
+		{
+			std::array<float, 256> table{};
+			for (int i{}; i < 256; ++i)
+				table[i] = i * (1.f / 255.f);
+			return table;
+		}() };
+
+	//Rounds towards -infinity, texel coordinates left of or above the texture are negative
+	int FloorToInt(float value)
+	{
+		const int truncated{ static_cast<int>(value) };
+		return truncated - (value < static_cast<float>(truncated));
+	}
+
+	//Repeats [0, size): a mask for powers of two (every level of a power of two texture), else the remainder made positive
+	int WrapCoordinate(int coordinate, int size)
+	{
+		if ((size & (size - 1)) == 0)
+			return coordinate & (size - 1);
+
+		const int remainder{ coordinate % size };
+		return remainder + ((remainder >> 31) & size);
+	}
+
+	//Texel coordinate -> texel inside [0, size), branch free apart from the power of two test (the same for every sample of a level)
+	//Scalar only: the shaders sample one lane at a time, there is no lane-wide texel fetch to address for
+	template<AddressMode addressMode>
+	int Address(int coordinate, int size)
+	{
+		if constexpr (addressMode == AddressMode::Wrap)
+		{
+			return WrapCoordinate(coordinate, size);
+		}
+		else if constexpr (addressMode == AddressMode::Mirror)
+		{
+			//Wrapped over twice the size, the second half runs backwards
+			const int period{ 2 * size };
+			const int wrapped{ WrapCoordinate(coordinate, period) };
+			return std::min(wrapped, period - 1 - wrapped);
+		}
+		else
+		{
+			//Clamp, Border clamps the fetch too and drops the texel afterwards
+			return std::clamp(coordinate, 0, size - 1);
+		}
+	}
+}
+
 
 //-----------------------------------------------------------------
 // Constructors
 //-----------------------------------------------------------------
-Texture::Texture(ID3D11Device* pDevice, const std::string& path)
+Texture::Texture(const std::string& path, TexelLayout layout)
 {
-	//Load SDL_Surface using IMG_LOAD
+#if defined(HEADLESS)
+	//Load RGBA pixels using libpng (same memory layout as SDL_PIXELFORMAT_RGBA32)
+	png_image image{};
+	image.version = PNG_IMAGE_VERSION;
+
+	const bool isLoaded = png_image_begin_read_from_file(&image, path.c_str()) != 0;
+	assert(isLoaded && "Image failed to load!");
+	if (!isLoaded)
+		return;
+
+	image.format = PNG_FORMAT_RGBA;
+	m_Width = static_cast<int>(image.width);
+	m_Height = static_cast<int>(image.height);
+	m_pSurfacePixels = new uint32_t[m_Width * m_Height];
+
+	//A truncated or corrupt file fails here, the texture stays empty and samples black
+	const bool isRead = png_image_finish_read(&image, nullptr, m_pSurfacePixels, 0, nullptr) != 0;
+	assert(isRead && "Image failed to load!");
+	if (!isRead)
+	{
+		png_image_free(&image);
+		delete[] m_pSurfacePixels;
+		m_pSurfacePixels = nullptr;
+		m_Width = 0;
+		m_Height = 0;
+		return;
+	}
+#else
+	//Load SDL_Surface using IMG_LOAD, converted once to RGBA8 (the layout of the headless build and the D3D upload)
 	SDL_Surface* pSurface = IMG_Load(path.c_str());
 	assert(pSurface && "Image failed to load!");
-	m_pSurface = pSurface;
+	if (!pSurface)
+		return;
+
+	m_pSurface = SDL_ConvertSurfaceFormat(pSurface, SDL_PIXELFORMAT_RGBA32, 0);
+	SDL_FreeSurface(pSurface);
+	if (!m_pSurface)
+		return;
 	m_pSurfacePixels = (uint32_t*)m_pSurface->pixels;
+	m_Width = m_pSurface->w;
+	m_Height = m_pSurface->h;
+#endif
 
+	BuildMipChain();
+	if (layout == TexelLayout::Tiled)
+		TileMipChain();
+}
+
+#if !defined(HEADLESS)
+Texture::Texture(ID3D11Device* pDevice, const std::string& path)
+	: Texture(path, TexelLayout::Linear)
+{
+	if (m_MipLevels.empty())
+		return;
 
 	//Create Resource
 	DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
 	D3D11_TEXTURE2D_DESC desc{};
 	desc.Width = m_pSurface->w;
 	desc.Height = m_pSurface->h;
-	desc.MipLevels = 1;
+	desc.MipLevels = static_cast<UINT>(m_MipLevels.size());
 	desc.ArraySize = 1;
 	desc.Format = format;
 	desc.SampleDesc.Count = 1;
@@ -35,12 +143,23 @@ Texture::Texture(ID3D11Device* pDevice, const std::string& path)
 	desc.CPUAccessFlags = 0;
 	desc.MiscFlags = 0;
 
-	D3D11_SUBRESOURCE_DATA initData;
-	initData.pSysMem = m_pSurface->pixels;
-	initData.SysMemPitch = static_cast<UINT>(m_pSurface->pitch);
-	initData.SysMemSlicePitch = static_cast<UINT>(m_pSurface->h * m_pSurface->pitch);
+	//The CPU mip chain is uploaded as well, so both rasterizers filter the same levels
+	std::vector<D3D11_SUBRESOURCE_DATA> initData(m_MipLevels.size());
+	for (size_t i{}; i < m_MipLevels.size(); ++i)
+	{
+		const MipLevel& level{ m_MipLevels[i] };
+		initData[i].pSysMem = level.pPixels;
+		initData[i].SysMemPitch = static_cast<UINT>(level.width * sizeof(uint32_t));
+		initData[i].SysMemSlicePitch = static_cast<UINT>(level.width * level.height * sizeof(uint32_t));
+	}
+	initData[0].SysMemPitch = static_cast<UINT>(m_pSurface->pitch);
+	initData[0].SysMemSlicePitch = static_cast<UINT>(m_pSurface->h * m_pSurface->pitch);
+
+	HRESULT result = pDevice->CreateTexture2D(&desc, initData.data(), &m_pResource);
+
+	//The software rasterizer samples tiled texels, the linear ones were only kept for the upload
+	TileMipChain();
 
-	HRESULT result = pDevice->CreateTexture2D(&desc, &initData, &m_pResource);
 	if (FAILED(result))
 		return;
 
@@ -49,12 +168,13 @@ Texture::Texture(ID3D11Device* pDevice, const std::string& path)
 	D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc{};
 	SRVDesc.Format = format;
 	SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	SRVDesc.Texture1D.MipLevels = 1;
+	SRVDesc.Texture2D.MipLevels = desc.MipLevels;
 
 	result = pDevice->CreateShaderResourceView(m_pResource, &SRVDesc, &m_pSRV);
 	if (FAILED(result))
 		return;
 }
+#endif
 
 
 //-----------------------------------------------------------------
@@ -62,32 +182,338 @@ Texture::Texture(ID3D11Device* pDevice, const std::string& path)
 //-----------------------------------------------------------------
 Texture::~Texture()
 {
+	delete[] m_pMipPixels;
+	::operator delete[](m_pTiledPixels, std::align_val_t{ m_TileAlignment });
+
+#if defined(HEADLESS)
+	delete[] m_pSurfacePixels;
+#else
 	if (m_pSurface) SDL_FreeSurface(m_pSurface);
 
 	if (m_pSRV) m_pSRV->Release();
 	if (m_pResource) m_pResource->Release();
+#endif
 }
 
 
 //-----------------------------------------------------------------
 // Public Member Functions
 //-----------------------------------------------------------------
-ColorRGB Texture::Sample(const Vector2& uv) const
+MipSelection Texture::SelectMip(const Vector2& ddx, const Vector2& ddy, SamplerFilter filter) const
 {
-	int width = m_pSurface->w;
-	int height = m_pSurface->h;
+	//Magnification (or no derivatives) keeps the defaults: level 0, bilinear for Linear and Anisotropic
+	MipSelection mip{ filter };
 
-	int px = int(uv.x * width);
-	int py = int(uv.y * height);
+	//1. Footprint of the pixel in texels of level 0 (squared lengths of its axes)
+	const float axisXU{ ddx.x * m_Width };
+	const float axisXV{ ddx.y * m_Height };
+	const float axisYU{ ddy.x * m_Width };
+	const float axisYV{ ddy.y * m_Height };
+	const float lengthSqrX{ axisXU * axisXU + axisXV * axisXV };
+	const float lengthSqrY{ axisYU * axisYU + axisYV * axisYV };
+	const float maxLengthSqr{ std::max(lengthSqrX, lengthSqrY) };
+	const bool isMinified{ maxLengthSqr > 1.f };
 
-	Uint8 r, g, b;
-	SDL_GetRGB(m_pSurfacePixels[px + (py * width)], m_pSurface->format, &r, &g, &b);
+	//2. Level(s) per filter
+	switch (filter)
+	{
+	case SamplerFilter::Point:
+	{
+		//Nearest level, floor(log2(length) + 0.5) = floor(log2(2 * length^2) / 2) straight from the float exponent
+		const int nearestLevel{ static_cast<int>((std::bit_cast<uint32_t>(2.f * maxLengthSqr) >> 23) - 127) >> 1 };
+		mip.level = std::clamp(nearestLevel, 0, std::max(static_cast<int>(m_MipLevels.size()) - 1, 0));
+		break;
+	}
+	case SamplerFilter::Linear:
+	{
+		if (isMinified)
+			mip.lod = 0.5f * std::log2(maxLengthSqr);
+		break;
+	}
+	case SamplerFilter::Anisotropic:
+	{
+		if (!isMinified)
+			break;
 
-	return { r / 255.f, g / 255.f, b / 255.f };
+		//Probes along the major axis of the footprint, each one covering the minor axis
+		const float majorLength{ std::sqrt(maxLengthSqr) };
+		const float minorLength{ std::sqrt(std::min(lengthSqrX, lengthSqrY)) };
+		mip.numProbes = (minorLength * m_MaxAnisotropy > majorLength) ? static_cast<int>(std::ceil(majorLength / minorLength)) : m_MaxAnisotropy;
+		mip.lod = std::log2(majorLength / mip.numProbes);
+		mip.majorAxis = (lengthSqrX >= lengthSqrY) ? ddx : ddy;
+		break;
+	}
+	default:
+		break;
+	}
+	return mip;
+}
+
+template<AddressMode addressMode>
+ColorRGB Texture::Sample(const Vector2& uv, const MipSelection& mip) const
+{
+	const RGBA texel{ SampleRGBA<addressMode>(uv, mip) };
+	return { texel.r, texel.g, texel.b };
+}
+
+template<AddressMode addressMode>
+ColorRGB Texture::Sample(const Vector2& uv, const MipSelection& mip, float& alpha) const
+{
+	const RGBA texel{ SampleRGBA<addressMode>(uv, mip) };
+	alpha = texel.a;
+	return { texel.r, texel.g, texel.b };
 }
 
 
 //-----------------------------------------------------------------
 // Private Member Functions
 //-----------------------------------------------------------------
+void Texture::BuildMipChain()
+{
+	//1. Every level halves the one above it, down to 1x1
+	if (!m_pSurfacePixels)
+		return;
+	m_MipLevels.push_back({ m_pSurfacePixels, m_Width, m_Height });
+
+	size_t numMipPixels{};
+	for (int width{ m_Width }, height{ m_Height }; width > 1 || height > 1; )
+	{
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		numMipPixels += static_cast<size_t>(width) * height;
+	}
+
+	if (numMipPixels == 0)
+		return;
+	m_pMipPixels = new uint32_t[numMipPixels];
+
+	//2. 2x2 box filter of the level above, per 8-bit channel of the RGBA8 texels
+	uint32_t* pMipPixels{ m_pMipPixels };
+	while (m_MipLevels.back().width > 1 || m_MipLevels.back().height > 1)
+	{
+		const MipLevel source{ m_MipLevels.back() };
+		const MipLevel level{ pMipPixels, std::max(source.width / 2, 1), std::max(source.height / 2, 1) };
+
+		for (int y{}; y < level.height; ++y)
+		{
+			const uint32_t* pRow0{ source.pPixels + (2 * y) * source.width };
+			const uint32_t* pRow1{ source.pPixels + std::min(2 * y + 1, source.height - 1) * source.width };
+
+			for (int x{}; x < level.width; ++x)
+			{
+				const int x0{ 2 * x };
+				const int x1{ std::min(2 * x + 1, source.width - 1) };
+
+				uint32_t texel{};
+				for (int shift{}; shift < 32; shift += 8)
+				{
+					const uint32_t sum{ ((pRow0[x0] >> shift) & 0xFF) + ((pRow0[x1] >> shift) & 0xFF) + ((pRow1[x0] >> shift) & 0xFF) + ((pRow1[x1] >> shift) & 0xFF) };
+					texel |= ((sum + 2) / 4) << shift;
+				}
+				pMipPixels[x + y * level.width] = texel;
+			}
+		}
+
+		m_MipLevels.push_back(level);
+		pMipPixels += level.width * level.height;
+	}
+}
+
+void Texture::TileMipChain()
+{
+	if (m_TexelLayout == TexelLayout::Tiled || m_MipLevels.empty())
+		return;
 
+	//1. Levels are padded to whole tiles, the padding is never addressed
+	size_t numTiledPixels{};
+	for (const MipLevel& level : m_MipLevels)
+	{
+		const int tilesPerRow{ (level.width + m_TileSize - 1) >> m_TileShift };
+		const int tilesPerColumn{ (level.height + m_TileSize - 1) >> m_TileShift };
+		numTiledPixels += static_cast<size_t>(tilesPerRow) * tilesPerColumn * m_TileSize * m_TileSize;
+	}
+	m_pTiledPixels = new (std::align_val_t{ m_TileAlignment }) uint32_t[numTiledPixels]{};
+
+	//2. Copy every level tile by tile (a tile is one contiguous run of texels, row by row)
+	uint32_t* pTiledPixels{ m_pTiledPixels };
+	for (MipLevel& level : m_MipLevels)
+	{
+		const int tilesPerRow{ (level.width + m_TileSize - 1) >> m_TileShift };
+		const int tilesPerColumn{ (level.height + m_TileSize - 1) >> m_TileShift };
+
+		for (int y{}; y < level.height; ++y)
+		{
+			for (int x{}; x < level.width; ++x)
+			{
+				pTiledPixels[GetTiledIndex(x, y, tilesPerRow)] = level.pPixels[x + y * level.width];
+			}
+		}
+
+		level.pPixels = pTiledPixels;
+		level.tilesPerRow = tilesPerRow;
+		pTiledPixels += static_cast<size_t>(tilesPerRow) * tilesPerColumn * m_TileSize * m_TileSize;
+	}
+	m_TexelLayout = TexelLayout::Tiled;
+
+	//3. The linear pixels are no longer needed
+	delete[] m_pMipPixels;
+	m_pMipPixels = nullptr;
+#if defined(HEADLESS)
+	delete[] m_pSurfacePixels;
+#else
+	SDL_FreeSurface(m_pSurface);
+	m_pSurface = nullptr;
+#endif
+	m_pSurfacePixels = nullptr;
+}
+
+template<AddressMode addressMode>
+Texture::RGBA Texture::SampleRGBA(const Vector2& uv, const MipSelection& mip) const
+{
+	//An image that failed to load has no levels
+	if (m_MipLevels.empty())
+		return {};
+
+	if (m_TexelLayout == TexelLayout::Tiled)
+		return SampleLevels<addressMode, TexelLayout::Tiled>(uv, mip);
+	return SampleLevels<addressMode, TexelLayout::Linear>(uv, mip);
+}
+
+template<AddressMode addressMode, TexelLayout layout>
+Texture::RGBA Texture::SampleLevels(const Vector2& uv, const MipSelection& mip) const
+{
+	//Linear is anisotropic filtering with a single probe
+	if (mip.filter == SamplerFilter::Point)
+		return SamplePoint<addressMode, layout>(m_MipLevels[std::min(mip.level, static_cast<int>(m_MipLevels.size()) - 1)], uv);
+	if (mip.numProbes == 1)
+		return SampleTrilinear<addressMode, layout>(uv, mip.lod);
+
+	return SampleAnisotropic<addressMode, layout>(uv, mip);
+}
+
+template<AddressMode addressMode, TexelLayout layout>
+Texture::RGBA Texture::SampleAnisotropic(const Vector2& uv, const MipSelection& mip) const
+{
+	//Trilinear probes spread evenly along the major axis of the footprint
+	const float weight{ 1.f / mip.numProbes };
+
+	RGBA sum{};
+	for (int i{}; i < mip.numProbes; ++i)
+	{
+		const float offset{ (i + 0.5f) * weight - 0.5f };
+		const RGBA probe{ SampleTrilinear<addressMode, layout>({ uv.x + offset * mip.majorAxis.x, uv.y + offset * mip.majorAxis.y }, mip.lod) };
+		sum.r += probe.r;
+		sum.g += probe.g;
+		sum.b += probe.b;
+		sum.a += probe.a;
+	}
+	return { sum.r * weight, sum.g * weight, sum.b * weight, sum.a * weight };
+}
+
+template<AddressMode addressMode, TexelLayout layout>
+Texture::RGBA Texture::SamplePoint(const MipLevel& level, const Vector2& uv) const
+{
+	return GetTexel<addressMode, layout>(level, FloorToInt(uv.x * level.width), FloorToInt(uv.y * level.height));
+}
+
+template<AddressMode addressMode, TexelLayout layout>
+Texture::RGBA Texture::SampleBilinear(const MipLevel& level, const Vector2& uv) const
+{
+	//Texel centers sit at half coordinates
+	const float x{ uv.x * level.width - 0.5f };
+	const float y{ uv.y * level.height - 0.5f };
+	const int x0{ FloorToInt(x) };
+	const int y0{ FloorToInt(y) };
+	const float tx{ x - x0 };
+	const float ty{ y - y0 };
+
+	const RGBA t00{ GetTexel<addressMode, layout>(level, x0, y0) };
+	const RGBA t10{ GetTexel<addressMode, layout>(level, x0 + 1, y0) };
+	const RGBA t01{ GetTexel<addressMode, layout>(level, x0, y0 + 1) };
+	const RGBA t11{ GetTexel<addressMode, layout>(level, x0 + 1, y0 + 1) };
+
+	const float w00{ (1.f - tx) * (1.f - ty) };
+	const float w10{ tx * (1.f - ty) };
+	const float w01{ (1.f - tx) * ty };
+	const float w11{ tx * ty };
+
+	return
+	{
+		t00.r * w00 + t10.r * w10 + t01.r * w01 + t11.r * w11,
+		t00.g * w00 + t10.g * w10 + t01.g * w01 + t11.g * w11,
+		t00.b * w00 + t10.b * w10 + t01.b * w01 + t11.b * w11,
+		t00.a * w00 + t10.a * w10 + t01.a * w01 + t11.a * w11
+	};
+}
+
+template<AddressMode addressMode, TexelLayout layout>
+Texture::RGBA Texture::SampleTrilinear(const Vector2& uv, float lod) const
+{
+	//Bilinear in the two levels around lod, blended by its fraction
+	const int lastLevel{ static_cast<int>(m_MipLevels.size()) - 1 };
+	if (!(lod > 0.f))
+		return SampleBilinear<addressMode, layout>(m_MipLevels[0], uv);
+	if (lod >= lastLevel)
+		return SampleBilinear<addressMode, layout>(m_MipLevels[lastLevel], uv);
+
+	const int level{ static_cast<int>(lod) };
+	const float t{ lod - level };
+
+	const RGBA fine{ SampleBilinear<addressMode, layout>(m_MipLevels[level], uv) };
+	if (t == 0.f)
+		return fine;
+
+	const RGBA coarse{ SampleBilinear<addressMode, layout>(m_MipLevels[level + 1], uv) };
+	return
+	{
+		fine.r + (coarse.r - fine.r) * t,
+		fine.g + (coarse.g - fine.g) * t,
+		fine.b + (coarse.b - fine.b) * t,
+		fine.a + (coarse.a - fine.a) * t
+	};
+}
+
+template<AddressMode addressMode, TexelLayout layout>
+Texture::RGBA Texture::GetTexel(const MipLevel& level, int x, int y) const
+{
+	//Border reads a transparent black texel outside the texture: the fetch gets clamped, its result dropped
+	const int isInside{ (static_cast<unsigned>(x) < static_cast<unsigned>(level.width)) & (static_cast<unsigned>(y) < static_cast<unsigned>(level.height)) };
+	x = Address<addressMode>(x, level.width);
+	y = Address<addressMode>(y, level.height);
+
+	int index{};
+	if constexpr (layout == TexelLayout::Tiled)
+		index = GetTiledIndex(x, y, level.tilesPerRow);
+	else
+		index = x + (y * level.width);
+	const uint32_t pixel{ level.pPixels[index] };
+
+	//RGBA8 in both builds: fixed shifts, the table turns the bytes into floats
+	const RGBA texel{ g_ByteToUnit[pixel & 0xFF], g_ByteToUnit[(pixel >> 8) & 0xFF], g_ByteToUnit[(pixel >> 16) & 0xFF], g_ByteToUnit[pixel >> 24] };
+	if constexpr (addressMode == AddressMode::Border)
+	{
+		const float border{ static_cast<float>(isInside) };
+		return { texel.r * border, texel.g * border, texel.b * border, texel.a * border };
+	}
+	return texel;
+}
+
+int Texture::GetTiledIndex(int x, int y, int tilesPerRow)
+{
+	//Index of the tile, then of the texel within it
+	const int tile{ (y >> m_TileShift) * tilesPerRow + (x >> m_TileShift) };
+	return (tile << (2 * m_TileShift)) + ((y & (m_TileSize - 1)) << m_TileShift) + (x & (m_TileSize - 1));
+}
+
+
+//-----------------------------------------------------------------
+// Explicit Instantiations
+//-----------------------------------------------------------------
+template ColorRGB Texture::Sample<AddressMode::Wrap>(const Vector2&, const MipSelection&) const;
+template ColorRGB Texture::Sample<AddressMode::Clamp>(const Vector2&, const MipSelection&) const;
+template ColorRGB Texture::Sample<AddressMode::Mirror>(const Vector2&, const MipSelection&) const;
+template ColorRGB Texture::Sample<AddressMode::Border>(const Vector2&, const MipSelection&) const;
+template ColorRGB Texture::Sample<AddressMode::Wrap>(const Vector2&, const MipSelection&, float&) const;
+template ColorRGB Texture::Sample<AddressMode::Clamp>(const Vector2&, const MipSelection&, float&) const;
+template ColorRGB Texture::Sample<AddressMode::Mirror>(const Vector2&, const MipSelection&, float&) const;
+template ColorRGB Texture::Sample<AddressMode::Border>(const Vector2&, const MipSelection&, float&) const;
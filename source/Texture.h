@@ -1,16 +1,38 @@
 #pragma once
 // Includes
+#include "DataTypes.h"
 
 namespace dae
 {
 	// Class Forward Declarations
+
+	//How the texels of every mip level are laid out in memory
+	enum class TexelLayout
+	{
+		Linear,		//Rows, like the loaded image and the D3D upload
+		Tiled,		//4x4 tiles of one cache line each in rows of tiles, rotated uv walks stay in the same lines
+	};
+
+	//Mip level(s) a sample filters, picked from the screen space derivatives of its uv
+	//Only depends on the size of level 0: one selection serves every texture of that size sampled by the same quad
+	struct MipSelection
+	{
+		SamplerFilter filter{};
+		int level{};			//Point: the nearest level
+		float lod{};			//Linear and Anisotropic: trilinear between the levels around it, 0 or less is level 0
+		int numProbes{ 1 };		//Anisotropic: trilinear probes spread along majorAxis
+		Vector2 majorAxis{};
+	};
 	
 	// Class Declaration
 	class Texture final
 	{
 	public:
 		// Constructors and Destructor
+		explicit Texture(const std::string& path, TexelLayout layout = TexelLayout::Tiled);
+#if !defined(HEADLESS)
 		explicit Texture(ID3D11Device* pDevice, const std::string& path);
+#endif
 		~Texture();
 		
 		// Copy and Move semantics
@@ -22,22 +44,83 @@ namespace dae
 		//---------------------------
 		// Public Member Functions
 		//---------------------------
-		ColorRGB Sample(const Vector2& uv) const;
+		//Software counterpart of the effect samplers: ddx/ddy are the screen space derivatives of uv
+		//The derivatives are coarse, so shaders select once per quad and sample every texture of the same size with it
+		MipSelection SelectMip(const Vector2& ddx, const Vector2& ddy, SamplerFilter filter) const;
+		bool HasSameSize(const Texture& other) const { return m_Width == other.m_Width && m_Height == other.m_Height; }
+
+		//The address mode is fixed per material at compile time
+		template<AddressMode addressMode>
+		ColorRGB Sample(const Vector2& uv, const MipSelection& mip) const;
+		template<AddressMode addressMode>
+		ColorRGB Sample(const Vector2& uv, const MipSelection& mip, float& alpha) const;
 
 		ID3D11ShaderResourceView* GetResourceView() const { return m_pSRV; }
 	
 	
 	private:
+		//One level of the mip chain, level 0 are the loaded pixels
+		struct MipLevel
+		{
+			const uint32_t* pPixels{};
+			int width{};
+			int height{};
+			int tilesPerRow{};
+		};
+
+		struct RGBA
+		{
+			float r{};
+			float g{};
+			float b{};
+			float a{};
+		};
+
 		// Member variables
 		ID3D11Texture2D* m_pResource{};
 		ID3D11ShaderResourceView* m_pSRV{};
 
+#if !defined(HEADLESS)
 		SDL_Surface* m_pSurface{ nullptr };
+#endif
 		uint32_t* m_pSurfacePixels{ nullptr };
+		int m_Width{};
+		int m_Height{};
+
+		std::vector<MipLevel> m_MipLevels{};
+		uint32_t* m_pMipPixels{ nullptr }; //Every level below level 0, in one allocation
+
+		TexelLayout m_TexelLayout{ TexelLayout::Linear };
+		uint32_t* m_pTiledPixels{ nullptr }; //Every level once tiled, the linear pixels are released then
+		static constexpr int m_TileShift{ 2 };
+		static constexpr int m_TileSize{ 1 << m_TileShift };
+		static constexpr size_t m_TileAlignment{ m_TileSize * m_TileSize * sizeof(uint32_t) }; //A tile is one cache line when aligned to its size
+
+		//Most trilinear probes per anisotropic sample (the D3D11 default MaxAnisotropy of the effect samplers)
+		static constexpr int m_MaxAnisotropy{ 16 };
 	
 		//---------------------------
 		// Private Member Functions
 		//---------------------------
+		void BuildMipChain();
+		void TileMipChain();
+
+		template<AddressMode addressMode>
+		RGBA SampleRGBA(const Vector2& uv, const MipSelection& mip) const;
+		//Everything below is specialized per layout, the layout is picked once per sample
+		template<AddressMode addressMode, TexelLayout layout>
+		RGBA SampleLevels(const Vector2& uv, const MipSelection& mip) const;
+		template<AddressMode addressMode, TexelLayout layout>
+		RGBA SamplePoint(const MipLevel& level, const Vector2& uv) const;
+		template<AddressMode addressMode, TexelLayout layout>
+		RGBA SampleBilinear(const MipLevel& level, const Vector2& uv) const;
+		template<AddressMode addressMode, TexelLayout layout>
+		RGBA SampleTrilinear(const Vector2& uv, float lod) const;
+		template<AddressMode addressMode, TexelLayout layout>
+		RGBA SampleAnisotropic(const Vector2& uv, const MipSelection& mip) const;
+		template<AddressMode addressMode, TexelLayout layout>
+		RGBA GetTexel(const MipLevel& level, int x, int y) const;
+		static int GetTiledIndex(int x, int y, int tilesPerRow);
 	
 	};
 }
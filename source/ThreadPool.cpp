@@ -0,0 +1,112 @@
+//-----------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------
+#include "pch.h"
+#include "ThreadPool.h"
+
+using namespace dae;
+
+
+//-----------------------------------------------------------------
+// Constructors
+//-----------------------------------------------------------------
+ThreadPool::ThreadPool(uint32_t numThreads)
+{
+	//The calling thread always helps out, so spawn one worker less
+	for (uint32_t i{ 1 }; i < numThreads; ++i)
+	{
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+
+//-----------------------------------------------------------------
+// Destructor
+//-----------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_StartCondition.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+
+//-----------------------------------------------------------------
+// Private Member Functions
+//-----------------------------------------------------------------
+void ThreadPool::ParallelFor(uint32_t count, const void* pJob, JobInvoker pInvokeJob)
+{
+	if (count == 0)
+		return;
+
+	//Not worth waking anyone up
+	if (m_Workers.empty() || count == 1)
+	{
+		for (uint32_t i{}; i < count; ++i)
+		{
+			pInvokeJob(pJob, i);
+		}
+		return;
+	}
+
+	//1. Publish the jobs
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_pJob = pJob;
+		m_pInvokeJob = pInvokeJob;
+		m_JobCount = count;
+		m_NextJob = 0;
+		m_NumBusyWorkers = static_cast<uint32_t>(m_Workers.size());
+		++m_Generation;
+	}
+	m_StartCondition.notify_all();
+
+	//2. Help out
+	RunJobs();
+
+	//3. Wait for the workers to finish their last job
+	std::unique_lock<std::mutex> lock{ m_Mutex };
+	m_DoneCondition.wait(lock, [this]() { return m_NumBusyWorkers == 0; });
+	m_pJob = nullptr;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	uint64_t generation{};
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			m_StartCondition.wait(lock, [this, generation]() { return m_IsStopping || m_Generation != generation; });
+
+			if (m_IsStopping)
+				return;
+
+			generation = m_Generation;
+		}
+
+		RunJobs();
+
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			if (--m_NumBusyWorkers == 0)
+				m_DoneCondition.notify_one();
+		}
+	}
+}
+
+void ThreadPool::RunJobs()
+{
+	for (uint32_t i{ m_NextJob++ }; i < m_JobCount; i = m_NextJob++)
+	{
+		m_pInvokeJob(m_pJob, i);
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+// Includes
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace dae
+{
+	// Class Declaration
+	class ThreadPool final
+	{
+	public:
+		// Constructors and Destructor
+		explicit ThreadPool(uint32_t numThreads = std::thread::hardware_concurrency());
+		~ThreadPool();
+
+		// Copy and Move semantics
+		ThreadPool(const ThreadPool& other)					= delete;
+		ThreadPool& operator=(const ThreadPool& other)		= delete;
+		ThreadPool(ThreadPool&& other) noexcept				= delete;
+		ThreadPool& operator=(ThreadPool&& other) noexcept	= delete;
+
+		//---------------------------
+		// Public Member Functions
+		//---------------------------
+		//Runs job(0) ... job(count - 1) spread over all threads, the calling thread included
+		//Returns once every job has finished
+		//The job is only referenced, not copied into a std::function, so starting jobs never allocates
+		template<typename Job>
+		void ParallelFor(uint32_t count, const Job& job)
+		{
+			ParallelFor(count, &job, [](const void* pJob, uint32_t index) { (*static_cast<const Job*>(pJob))(index); });
+		}
+
+		//Worker threads + the calling thread
+		uint32_t GetNumThreads() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+
+
+	private:
+		using JobInvoker = void(*)(const void* pJob, uint32_t index);
+
+		// Member variables
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_StartCondition{};
+		std::condition_variable m_DoneCondition{};
+
+		const void* m_pJob{};
+		JobInvoker m_pInvokeJob{};
+		uint32_t m_JobCount{};
+		std::atomic<uint32_t> m_NextJob{};
+
+		uint64_t m_Generation{};
+		uint32_t m_NumBusyWorkers{};
+		bool m_IsStopping{ false };
+
+		//---------------------------
+		// Private Member Functions
+		//---------------------------
+		void ParallelFor(uint32_t count, const void* pJob, JobInvoker pInvokeJob);
+		void WorkerLoop();
+		void RunJobs();
+
+	};
+}
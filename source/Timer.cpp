@@ -1,17 +1,42 @@
 #include "pch.h"
 #include "Timer.h"
 
+#if defined(HEADLESS)
+#include <chrono>
+#endif
+
+namespace
+{
+	uint64_t GetPerformanceCounter()
+	{
+#if defined(HEADLESS)
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#else
+		return SDL_GetPerformanceCounter();
+#endif
+	}
+
+	uint64_t GetPerformanceFrequency()
+	{
+#if defined(HEADLESS)
+		return static_cast<uint64_t>(std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num);
+#else
+		return SDL_GetPerformanceFrequency();
+#endif
+	}
+}
+
 namespace dae
 {
 	Timer::Timer()
 	{
-		const uint64_t countsPerSecond = SDL_GetPerformanceFrequency();
+		const uint64_t countsPerSecond = GetPerformanceFrequency();
 		m_SecondsPerCount = 1.0f / static_cast<float>(countsPerSecond);
 	}
 
 	void Timer::Reset()
 	{
-		const uint64_t currentTime = SDL_GetPerformanceCounter();
+		const uint64_t currentTime = GetPerformanceCounter();
 
 		m_BaseTime = currentTime;
 		m_PreviousTime = currentTime;
@@ -23,7 +48,7 @@ namespace dae
 
 	void Timer::Start()
 	{
-		const uint64_t startTime = SDL_GetPerformanceCounter();
+		const uint64_t startTime = GetPerformanceCounter();
 
 		if (m_IsStopped)
 		{
@@ -45,7 +70,7 @@ namespace dae
 			return;
 		}
 
-		const uint64_t currentTime = SDL_GetPerformanceCounter();
+		const uint64_t currentTime = GetPerformanceCounter();
 		m_CurrentTime = currentTime;
 
 		m_ElapsedTime = static_cast<float>(m_CurrentTime - m_PreviousTime) * m_SecondsPerCount;
@@ -77,7 +102,7 @@ namespace dae
 	{
 		if (!m_IsStopped)
 		{
-			const uint64_t currentTime = SDL_GetPerformanceCounter();
+			const uint64_t currentTime = GetPerformanceCounter();
 
 			m_StopTime = currentTime;
 			m_IsStopped = true;
@@ -78,6 +78,14 @@ int main(int argc, char* args[])
 					pRenderer->ToggleUniformClearColor();
 				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
 					pRenderer->TogglePrintFPS();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F12)
+					pRenderer->ToggleFixedPoint();
+				if (e.key.keysym.scancode == SDL_SCANCODE_V)
+					pRenderer->ToggleDeferred();
+				if (e.key.keysym.scancode == SDL_SCANCODE_L)
+					pRenderer->ToggleLazyVertexShading();
+				if (e.key.keysym.scancode == SDL_SCANCODE_O)
+					pRenderer->ToggleWeightedBlended();
 				break;
 			default: ;
 			}
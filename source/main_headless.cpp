@@ -0,0 +1,335 @@
+#include "pch.h"
+#include "HeadlessRenderer.h"
+#include "Scene.h"
+#include "SIMD.h"
+#include "Texture.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+void PrintUsage()
+{
+	std::cout << "Usage: DualRasterizerHeadless [options]\n";
+	std::cout << "\t-width <pixels>   Width of the offscreen framebuffer (default 640)\n";
+	std::cout << "\t-height <pixels>  Height of the offscreen framebuffer (default 480)\n";
+	std::cout << "\t-frames <count>   Number of frames to render (default 100)\n";
+	std::cout << "\t-threads <count>  Number of rasterizer threads (default: one per core)\n";
+	std::cout << "\t-output <file>    Write the last frame as binary PPM\n";
+	std::cout << "\t-static           Disable vehicle rotation (deterministic frames)\n";
+	std::cout << "\t-float            Use floating point edge functions instead of fixed point\n";
+	std::cout << "\t-deferred         Shade once per pixel from a visibility buffer\n";
+	std::cout << "\t-eager            Shade every used vertex up front instead of lazily during setup\n";
+	std::cout << "\t-nofire           Do not draw the (alpha blended) FireFX\n";
+	std::cout << "\t-oit              Weighted blended order independent transparency instead of sorting\n";
+	std::cout << "\t-cull <mode>      Cull mode: back, front or none (default back)\n";
+	std::cout << "\t-filter <filter>  Texture filter: point, linear or anisotropic (default point)\n";
+	std::cout << "\t-simd <level>     Widest pixel kernel to use: scalar, sse2 or avx2 (default: detected), avx2 frames differ in a few pixels (FMA rounding)\n";
+	std::cout << "\t-texbench         Benchmark texture sampling in both texel layouts, then exit\n";
+}
+
+//L1 data cache read misses of this thread, -1 where hardware counters are unavailable (platform or permissions)
+int OpenCacheMissCounter()
+{
+#if defined(__linux__)
+	perf_event_attr attr{};
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+	return -1;
+#endif
+}
+
+void StartCounter(int counter)
+{
+#if defined(__linux__)
+	if (counter < 0) return;
+	ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+	ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+uint64_t StopCounter(int counter)
+{
+	uint64_t count{};
+#if defined(__linux__)
+	if (counter < 0) return count;
+	ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+	if (read(counter, &count, sizeof(count)) != sizeof(count))
+		count = 0;
+#endif
+	return count;
+}
+
+//Samples the vehicle diffuse texture along screen rows rotated over it (one texel per pixel, like the spinning vehicle)
+//once per texel layout, filter and angle
+void RunTextureBenchmark()
+{
+	constexpr int walkSize = 512;
+	constexpr int numRepeats = 5;
+	constexpr float texelSize = 1.f / 1024.f; //vehicle_diffuse.png is 1024x1024
+	constexpr float angles[]{ 0.f, 30.f, 45.f, 90.f };
+	const TexelLayout layouts[]{ TexelLayout::Linear, TexelLayout::Tiled };
+	const char* layoutNames[]{ "linear", "tiled " };
+	const SamplerFilter filters[]{ SamplerFilter::Point, SamplerFilter::Linear };
+	const char* filterNames[]{ "point ", "linear" };
+
+	const int counter = OpenCacheMissCounter();
+	std::cout << "Texture sampling: " << walkSize << "x" << walkSize << " samples per walk, best of " << numRepeats << "\n";
+
+	float checksum{};
+	for (int layout{}; layout < 2; ++layout)
+	{
+		const Texture texture{ "Resources/vehicle_diffuse.png", layouts[layout] };
+
+		for (int filter{}; filter < 2; ++filter)
+		{
+			for (float angle : angles)
+			{
+				const float cosAngle = std::cos(angle * TO_RADIANS);
+				const float sinAngle = std::sin(angle * TO_RADIANS);
+				const Vector2 ddx{ cosAngle * texelSize, sinAngle * texelSize };
+				const Vector2 ddy{ -sinAngle * texelSize, cosAngle * texelSize };
+				const MipSelection mip = texture.SelectMip(ddx, ddy, filters[filter]); //The footprint is the same for the whole walk
+				constexpr float halfSize = walkSize * .5f;
+
+				double bestNs{ DBL_MAX };
+				uint64_t bestMisses{};
+				for (int repeat{}; repeat < numRepeats; ++repeat)
+				{
+					StartCounter(counter);
+					const auto start = std::chrono::steady_clock::now();
+					for (int y{}; y < walkSize; ++y)
+					{
+						const Vector2 rowStart{ .5f + (y - halfSize) * ddy.x - halfSize * ddx.x, .5f + (y - halfSize) * ddy.y - halfSize * ddx.y };
+						for (int x{}; x < walkSize; ++x)
+						{
+							const Vector2 uv{ rowStart.x + x * ddx.x, rowStart.y + x * ddx.y };
+							checksum += texture.Sample<AddressMode::Wrap>(uv, mip).r;
+						}
+					}
+					const auto end = std::chrono::steady_clock::now();
+					const uint64_t misses = StopCounter(counter);
+
+					const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+					if (ns < bestNs)
+					{
+						bestNs = ns;
+						bestMisses = misses;
+					}
+				}
+
+				constexpr double numSamples = double(walkSize) * walkSize;
+				std::cout << "\t" << layoutNames[layout] << " " << filterNames[filter] << " " << angle << " deg: " << bestNs / numSamples << " ns/sample";
+				if (counter >= 0)
+					std::cout << ", " << bestMisses / numSamples << " L1D misses/sample";
+				std::cout << "\n";
+			}
+		}
+	}
+
+#if defined(__linux__)
+	if (counter >= 0) close(counter);
+#endif
+	if (counter < 0)
+		std::cout << "(no hardware cache counters available)\n";
+	std::cout << "Checksum: " << checksum << std::endl;
+}
+
+int main(int argc, char* args[])
+{
+	int width = 640;
+	int height = 480;
+	int numFrames = 100;
+	int numThreads = static_cast<int>(std::thread::hardware_concurrency());
+	std::string outputPath{};
+	bool isStatic = false;
+	bool isFloat = false;
+	bool isDeferred = false;
+	bool isEager = false;
+	bool isNoFire = false;
+	bool isWeightedBlended = false;
+	CullMode cullMode = CullMode::Back;
+	SamplerFilter samplerFilter = SamplerFilter::Point;
+	bool isTextureBenchmark = false;
+
+	//Parse arguments
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (!strcmp(args[i], "-width") && hasValue)
+			width = std::atoi(args[++i]);
+		else if (!strcmp(args[i], "-height") && hasValue)
+			height = std::atoi(args[++i]);
+		else if (!strcmp(args[i], "-frames") && hasValue)
+			numFrames = std::atoi(args[++i]);
+		else if (!strcmp(args[i], "-threads") && hasValue)
+			numThreads = std::atoi(args[++i]);
+		else if (!strcmp(args[i], "-output") && hasValue)
+			outputPath = args[++i];
+		else if (!strcmp(args[i], "-static"))
+			isStatic = true;
+		else if (!strcmp(args[i], "-float"))
+			isFloat = true;
+		else if (!strcmp(args[i], "-deferred"))
+			isDeferred = true;
+		else if (!strcmp(args[i], "-eager"))
+			isEager = true;
+		else if (!strcmp(args[i], "-nofire"))
+			isNoFire = true;
+		else if (!strcmp(args[i], "-oit"))
+			isWeightedBlended = true;
+		else if (!strcmp(args[i], "-texbench"))
+			isTextureBenchmark = true;
+		else if (!strcmp(args[i], "-cull") && hasValue)
+		{
+			++i;
+			if (!strcmp(args[i], "back"))
+				cullMode = CullMode::Back;
+			else if (!strcmp(args[i], "front"))
+				cullMode = CullMode::Front;
+			else if (!strcmp(args[i], "none"))
+				cullMode = CullMode::None;
+			else
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (!strcmp(args[i], "-filter") && hasValue)
+		{
+			++i;
+			if (!strcmp(args[i], "point"))
+				samplerFilter = SamplerFilter::Point;
+			else if (!strcmp(args[i], "linear"))
+				samplerFilter = SamplerFilter::Linear;
+			else if (!strcmp(args[i], "anisotropic"))
+				samplerFilter = SamplerFilter::Anisotropic;
+			else
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (!strcmp(args[i], "-simd") && hasValue)
+		{
+			++i;
+			if (!strcmp(args[i], "scalar"))
+				SIMD::SetMaxLevel(SIMDLevel::scalar);
+			else if (!strcmp(args[i], "sse2"))
+				SIMD::SetMaxLevel(SIMDLevel::sse2);
+			else if (!strcmp(args[i], "avx2"))
+				SIMD::SetMaxLevel(SIMDLevel::avx2);
+			else
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (width <= 0 || height <= 0 || numFrames < 0 || numThreads <= 0)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (isTextureBenchmark)
+	{
+		RunTextureBenchmark();
+		return 0;
+	}
+
+	//Initialize "framework"
+	const auto pTimer = new Timer();
+	const auto pRenderer = new HeadlessRenderer(width, height, static_cast<uint32_t>(numThreads));
+	if (isStatic)
+		pRenderer->GetScene()->ToggleRotation();
+	if (isFloat)
+		pRenderer->GetScene()->ToggleFixedPoint();
+	if (isDeferred)
+		pRenderer->GetScene()->ToggleDeferred();
+	if (isEager)
+		pRenderer->GetScene()->ToggleLazyVertexShading();
+	if (isNoFire)
+		pRenderer->GetScene()->ToggleFireFX();
+	if (isWeightedBlended)
+		pRenderer->GetScene()->ToggleWeightedBlended();
+	pRenderer->GetScene()->SetCullMode(cullMode);
+	for (int filter{}; filter < static_cast<int>(samplerFilter); ++filter)
+		pRenderer->GetScene()->CycleSamplerState();
+
+	//Start loop
+	double totalRenderMs{};
+	double minRenderMs{ DBL_MAX };
+	double maxRenderMs{};
+
+	pTimer->Start();
+	for (int frame{}; frame < numFrames; ++frame)
+	{
+		//--------- Update ---------
+		pRenderer->Update(pTimer);
+
+		//--------- Render ---------
+		const auto start = std::chrono::steady_clock::now();
+		pRenderer->Render();
+		const auto end = std::chrono::steady_clock::now();
+
+		const double renderMs = std::chrono::duration<double, std::milli>(end - start).count();
+		totalRenderMs += renderMs;
+		minRenderMs = std::min(minRenderMs, renderMs);
+		maxRenderMs = std::max(maxRenderMs, renderMs);
+
+		//--------- Timer ---------
+		pTimer->Update();
+	}
+	pTimer->Stop();
+
+	//Report
+	if (numFrames > 0)
+	{
+		const double avgRenderMs = totalRenderMs / numFrames;
+		std::cout << "Frames: " << numFrames << " @ " << width << "x" << height << ", " << numThreads << " thread(s), " << SIMD::ToString(SIMD::GetLevel()) << "\n";
+		std::cout << "Render ms (avg/min/max): " << avgRenderMs << " / " << minRenderMs << " / " << maxRenderMs << "\n";
+		std::cout << "Render FPS (avg): " << 1000.0 / avgRenderMs << std::endl;
+
+		const PipelineStats& stats = pRenderer->GetScene()->GetSoftwareStats();
+		std::cout << "Vertices (last frame): " << stats.numVertices << ", shaded " << stats.numShadedVertices << "\n";
+		std::cout << "Triangles (last frame): " << stats.numTriangles << ", culled " << stats.numCulled << ", set up " << stats.numSetUp << "\n";
+		std::cout << "Hi-Z rejected (last frame): " << stats.numHiZTriangles << " / " << stats.numBinned << " binned triangles, " << stats.numHiZBlocks << " blocks\n";
+		std::cout << "Heap allocations (last frame): " << pRenderer->GetNumFrameAllocations() << std::endl;
+	}
+
+	int result = 0;
+	if (!outputPath.empty() && !pRenderer->SaveFrame(outputPath))
+	{
+		std::cout << "Failed to write " << outputPath << std::endl;
+		result = 1;
+	}
+
+	//Shutdown "framework"
+	delete pRenderer;
+	delete pTimer;
+
+	return result;
+}
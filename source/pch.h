@@ -5,8 +5,27 @@
 #include <algorithm>
 #include <sstream>
 #include <memory>
+#include <string>
+#include <cfloat>
+#include <cstdint>
 #define NOMINMAX  //for directx
 
+#if defined(HEADLESS)
+// Headless builds only carry the software pipeline: no window, no SDL, no DirectX.
+// The DirectX interfaces are forward declared so the shared class layouts stay identical.
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11Buffer;
+struct ID3D11InputLayout;
+struct ID3D11Texture2D;
+struct ID3D11RasterizerState;
+struct ID3D11ShaderResourceView;
+struct ID3DX11Effect;
+struct ID3DX11EffectTechnique;
+struct ID3DX11EffectMatrixVariable;
+struct ID3DX11EffectShaderResourceVariable;
+struct ID3DX11EffectRasterizerVariable;
+#else
 // SDL Headers
 #include "SDL.h"
 #include "SDL_syswm.h"
@@ -18,6 +37,7 @@
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #include <d3dx11effect.h>
+#endif
 
 // Framework Headers
 #include "Timer.h"